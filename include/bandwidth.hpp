@@ -0,0 +1,133 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+namespace asyd
+{
+// Schedules the transfers of this process (rsync uploads) under an
+// aggregate and a per-host bandwidth limit. Every transfer waits for a
+// slot and gets a share of the remaining budget as its rsync --bwlimit,
+// so the limits hold no matter how many transfers run at once. Waiting
+// transfers start by priority, then smallest first, then in order.
+class BandwidthScheduler
+{
+public:
+    enum class Priority
+    {
+        URGENT,     // e.g., hotfixes
+        NORMAL,
+        BULK,       // never gets more than half of a limit
+    };
+
+    // bandwidths in KB/s, 0 means unlimited
+    struct Limits
+    {
+        int64_t bandwidth_limit = 0;
+        int64_t host_bandwidth_limit = 0;
+        size_t max_transfers = 4;
+    };
+
+    struct Transfer
+    {
+        uint64_t id = 0;
+        std::string hostname;
+        std::string description;
+        uint64_t bytes = 0;
+        Priority priority = Priority::NORMAL;
+        bool active = false;
+        int64_t bandwidth_limit = 0;    // KB/s once active, 0 for unlimited
+        std::chrono::steady_clock::time_point queued_at;
+        std::chrono::steady_clock::time_point started_at;
+    };
+
+    // Permission to run a transfer, the transfer is finished when it's
+    // destroyed.
+    class Ticket
+    {
+    public:
+        Ticket(Ticket&& other);
+        ~Ticket();
+
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+        Ticket& operator=(Ticket&&) = delete;
+
+        // KB/s for rsync --bwlimit, 0 for unlimited
+        int64_t get_bandwidth_limit() const
+        {
+            return this->bandwidth_limit;
+        }
+
+    private:
+        friend class BandwidthScheduler;
+        Ticket(BandwidthScheduler* scheduler, uint64_t id, int64_t bandwidth_limit);
+
+        BandwidthScheduler* scheduler;
+        uint64_t id;
+        int64_t bandwidth_limit;
+    };
+
+    enum class Event
+    {
+        QUEUED,
+        STARTED,
+        FINISHED,
+    };
+
+    // Called with the transfer that was queued, started or finished and
+    // all transfers afterwards (outside the scheduler's lock).
+    typedef std::function<void(Event, const Transfer&, const std::vector<Transfer>&)> observer_fn;
+
+    // The scheduler of this process; its limits are loaded from
+    // ~/.asyd/.transfers (key=value) on first use.
+    static BandwidthScheduler& get();
+
+    void set_limits(const Limits& limits);
+    Limits get_limits() const;
+
+    // Reads the limits from a key=value file.
+    // Returns false if it doesn't exist.
+    bool load_limits(const std::string& filepath);
+
+    // Blocks until a transfer of [bytes] (0 if unknown) to [hostname] may start.
+    Ticket acquire(
+        const std::string& hostname,
+        const std::string& description,
+        uint64_t bytes,
+        Priority priority);
+
+    // queued and active transfers
+    std::vector<Transfer> get_transfers() const;
+
+    void set_observer(observer_fn observer);
+
+private:
+    BandwidthScheduler() {}
+
+    mutable std::mutex mutex;
+    std::condition_variable transfers_changed;
+
+    Limits limits;
+    std::list<Transfer> transfers;
+    uint64_t next_id = 1;
+    observer_fn observer;
+
+    void release(uint64_t id);
+
+    // bandwidth share [transfer] would get if started now; false if
+    // there is no slot or budget left for it
+    bool share_for(const Transfer& transfer, int64_t& bandwidth_limit) const;
+
+    // the queued transfer that starts next, null if none can start
+    const Transfer* next_transfer() const;
+
+    void notify(Event event, const Transfer& transfer, std::unique_lock<std::mutex>& lock);
+}; // class BandwidthScheduler
+}; // namespace asyd
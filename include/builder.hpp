@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "libasyd_types.hpp"
+
+namespace asyd
+{
+// forward declaration
+class Config;
+
+// Runs a project's local build (build_command) before deploys, keyed by
+// the hash of its inputs (build_inputs, see Scanner): the build is skipped
+// if the output in the working directory was built from the same inputs,
+// and the output of an earlier build with the same inputs is restored from
+// ~/.asyd/<project>/builds/<input hash>/ instead of building again.
+class Builder
+{
+public:
+    typedef BuildOutcome Outcome;
+
+    // outputs kept in the cache, the least recently used are removed
+    static const size_t MAX_CACHED_BUILDS = 5;
+
+    Builder(const Config& config);
+
+    // Brings the build output in the working directory up to date with
+    // the inputs, building only if there's no output for them yet.
+    Outcome build();
+
+    // output of the last build command that ran
+    std::string get_log_path() const;
+
+private:
+    const Config& config;
+    std::string cache_directory;
+
+    // true for the files (relative paths) the build reads
+    bool is_input(const std::string& path) const;
+
+    // combined hash of the inputs and the build command
+    bool hash_inputs(uint64_t& hash) const;
+
+    bool run_build_command() const;
+
+    // removes all but the MAX_CACHED_BUILDS most recently used outputs
+    void prune_cache() const;
+}; // class Builder
+}; // namespace asyd
@@ -8,6 +8,8 @@
 #include <fstream>
 #include <algorithm>
 #include <cstring>
+#include <map>
+#include <vector>
 
 namespace asyd
 {
@@ -31,19 +33,83 @@ public:
 
     bool remove_project(const std::string& project_name) const;
 
-    bool start_service(const std::string& project_name) const;
-    bool stop_service(const std::string& project_name) const;
-    bool restart_service(const std::string& project_name) const;
+    // watch the working directory and continuously sync changed files to
+    // the server and restart the service (until interrupted)
+    bool watch_project(const std::string& project_name) const;
 
-    // get the status of a service and write it into [output]
-    bool check_status(const std::string& project_name, std::string& output) const;
+    // apply [settings] (config key -> value) to a project's config,
+    // regenerate its systemd file(s) and update them on the server
+    bool configure_project(
+        const std::string& project_name,
+        const std::map<std::string, std::string>& settings) const;
+
+    // scan and hash the working directory (see Scanner), updating the
+    // project's scan cache, and print how much work the cache saved
+    bool scan_project(const std::string& project_name) const;
+
+    // measure the link to [hostname] again (see Link) and print
+    // the measurements and the transfer settings they lead to
+    bool measure_link(const std::string& hostname) const;
+
+    // live table of the resource usage of the services of the projects
+    // matching [patterns] (all if empty) on their hosts, sampled every
+    // [interval_sec] and sorted by [sort_key] (cpu, memory, io, tasks,
+    // restarts or name; can be changed with keys while running)
+    bool top(
+        const std::vector<std::string>& patterns,
+        int interval_sec,
+        const std::string& sort_key) const;
+
+    // journal of the services of the projects matching [patterns] on all
+    // their hosts (or of the projects on the hosts matching [patterns]),
+    // merged into one time-ordered stream (see LogMerger): the last
+    // [lines] entries and then new ones if [follow] (until interrupted)
+    bool logs(
+        const std::vector<std::string>& patterns,
+        int lines,
+        bool follow,
+        int reorder_window_ms) const;
+
+    // rebuild the local configs of the projects on [hostnames] (only those
+    // matching [patterns], all if empty) from their systemd files; every
+    // host is fetched in parallel as a single archive (see
+    // Server::fetch_unit_files()). Local-only settings of projects that
+    // already exist locally (e.g., the working directory) are kept.
+    bool pull(
+        const std::vector<std::string>& hostnames,
+        const std::vector<std::string>& patterns) const;
+
+    // create or update all projects declared in the manifest at
+    // [manifest_path] (see Manifest) without prompting. Hosts are set up
+    // in parallel, each over one persistent connection shared by its
+    // projects and with its facts (home and bash directory) fetched once.
+    bool apply(const std::string& manifest_path) const;
+
+    // status of a project's service and the services on a host, answered
+    // from the last observed one (see StatusCache) unless [fresh]; the age
+    // of a cached answer is printed to stderr
+    bool status(const std::string& project_name, bool fresh) const;
+    bool list_services(const std::string& hostname, bool fresh) const;
+
+    // Refreshes the cached answer of status() ([kind] "status") or
+    // list_services() ("ls") in a detached process; this is the process
+    // StatusCache starts for stale answers, not a user command.
+    bool refresh_cached(const std::string& kind, const std::string& name) const;
 
-private:
-    std::string get_home_dir() const;
-    std::string get_asyd_dir() const;
-    std::string get_asyd_project_dir(const std::string& projct_name) const;
+    // the last [max_runs] runs of a job (see JobHistory) with their
+    // duration, result and resource usage, percentiles of the durations
+    // and the runs that took longer than the project's overrun_fraction
+    // of the schedule interval
+    bool runs(const std::string& project_name, size_t max_runs) const;
 
-    // start/stop/restart service
-    bool service_action(const std::string& project_name, const std::string& action) const;
+    // run the shell [command] in the directory of every project matching
+    // [patterns] on each of its hosts, at most [max_parallel] at a time
+    // and each for at most [timeout_sec] (no limit if 0), with the output
+    // prefixed by project@host and a summary of the exit codes at the end
+    bool exec(
+        const std::vector<std::string>& patterns,
+        const std::string& command,
+        size_t max_parallel,
+        int timeout_sec) const;
 }; // class CLI
 }; // namespace asyd
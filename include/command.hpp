@@ -3,7 +3,9 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <atomic>
 #include <cstdio>
+#include <functional>
 
 namespace asyd
 {
@@ -25,11 +27,25 @@ public:
     // Fetch the output with command.get_output()
     bool execute();
 
+    // Executes the command and calls [on_line] with every line of its
+    // output as it arrives, for commands that run for long or forever
+    // (e.g., journalctl -f). The command is killed once [on_line] returns
+    // false or [cancelled] is set. Clears the command buffer.
+    // Returns false if the command failed (not if it was stopped).
+    bool stream(
+        const std::function<bool(const std::string&)>& on_line,
+        const std::atomic<bool>* cancelled = nullptr);
+
     // Returns the output from the executed command and clears buffer.
     const std::string& get_output() const;
+
+    // exit status of the last stream(), -1 if it was stopped or
+    // killed by a signal
+    int get_exit_status() const;
 private:
     std::vector<std::string> command_tokens;
     std::string command_output;
+    int exit_status = -1;
 
     std::string to_string();
 };
@@ -1,17 +1,24 @@
 #pragma once
 
 #include <string>
+#include <cstdlib>
 #include <fstream>
 #include <utility>
 #include <functional>
 #include <unordered_map>
+#include <map>
+#include <chrono>
 #include <filesystem>
 
+#include "libasyd_types.hpp"
 #include "util.hpp"
 #include "systemd.hpp"
 
 namespace asyd
 {
+// forward declaration
+class Server;
+
 class Config 
 {
 public:
@@ -26,10 +33,51 @@ public:
         this->key_action["working_directory"] = &Config::set_working_directory;
         this->key_action["entry_point"] = &Config::set_entry_point;
         this->key_action["schedule"] = &Config::set_schedule;
+        this->key_action["randomized_delay_sec"] = &Config::set_randomized_delay_sec;
+        this->key_action["accuracy_sec"] = &Config::set_accuracy_sec;
+        this->key_action["persistent"] = &Config::set_persistent;
+        this->key_action["overrun_fraction"] = &Config::set_overrun_fraction;
+        this->key_action["listen_stream"] = &Config::set_listen_stream;
+        this->key_action["idle_timeout_sec"] = &Config::set_idle_timeout_sec;
+        this->key_action["readiness"] = &Config::set_readiness;
+        this->key_action["readiness_timeout_sec"] = &Config::set_readiness_timeout_sec;
+        this->key_action["relay_hostname"] = &Config::set_relay_hostname;
+        this->key_action["relay_targets"] = &Config::set_relay_targets;
+        this->key_action["relay_fanout"] = &Config::set_relay_fanout;
+        this->key_action["restart_paths"] = &Config::set_restart_paths;
+        this->key_action["reload_paths"] = &Config::set_reload_paths;
+        this->key_action["ignore_paths"] = &Config::set_ignore_paths;
+        this->key_action["reload_signal"] = &Config::set_reload_signal;
+        this->key_action["instances"] = &Config::set_instances;
+        this->key_action["base_port"] = &Config::set_base_port;
+        this->key_action["pin_instances"] = &Config::set_pin_instances;
+        this->key_action["compression"] = &Config::set_compression;
+        this->key_action["cipher"] = &Config::set_cipher;
+        this->key_action["transfer_streams"] = &Config::set_transfer_streams;
+        this->key_action["transfer_priority"] = &Config::set_transfer_priority;
+        this->key_action["depends_on"] = &Config::set_depends_on;
+        this->key_action["build_command"] = &Config::set_build_command;
+        this->key_action["build_inputs"] = &Config::set_build_inputs;
+        this->key_action["build_output"] = &Config::set_build_output;
         this->key_action["server_home_directory"] = &Config::set_server_home_directory;
         this->key_action["server_bash_directory"] = &Config::set_server_bash_directory;
     }
 
+    // Sets a config setting by its key (as written in the config file).
+    // Returns false if the key is unknown or the value is invalid for it
+    // (see expected_value()).
+    bool set(const std::string& key, const std::string& value);
+
+    // What set() accepts for [key] if it checks the value (e.g., "a
+    // positive number of seconds"), empty for keys it doesn't check.
+    // An empty value is always accepted and means the default.
+    static std::string expected_value(const std::string& key);
+
+    bool is_setting(const std::string& key) const
+    {
+        return this->key_action.count(key) > 0 || Systemd::resource_control_directive(key).length() > 0;
+    }
+
     // Reads config settings from file.
     // Returns true on success, false otherwise.
     bool from_file(const std::string& filepath);
@@ -42,12 +90,79 @@ public:
     // setup systemd service properly (some distributions can vary)
     bool fetch_server_info();
 
+    // Writes the systemd file(s) of the project (see get_systemd_files())
+    // into [config_directory].
+    bool write_systemd_files(const std::string& config_directory) const;
+
+    // Copies the systemd file(s) of the project from [config_directory]
+    // to the server
+    bool copy_systemd_files(const Server& server, const std::string& config_directory) const;
+
+    // names of the project's systemd files: the .service (the @.service
+    // template for servers with several instances), the .timer for jobs
+    // and the .socket for socket-activated servers
+    std::vector<std::string> get_systemd_files() const
+    {
+        std::vector<std::string> systemd_files = { this->get_service_file() };
+
+        if (this->is_job())
+            systemd_files.push_back(this->project_name + ".timer");
+
+        if (this->is_socket_activated())
+            systemd_files.push_back(this->project_name + ".socket");
+
+        return systemd_files;
+    }
+
     // Copies the files from the local working directory to
     // ~/.asyd/project_name on the remote server
     // Copies the systemd service config to: /etc/systemd/system
-    // Starts the service
+    // Starts the service (and waits until it's ready, see start_service())
+    // Steps that aren't needed are skipped (see Planner).
     bool setup_server(const std::string& config_directory);
 
+    // Same as above over [server], e.g., to share one persistent connection
+    // between the setups of several projects on the same host.
+    bool setup_server(const Server& server, const std::string& config_directory);
+
+    // Starts ([restart] = false) or restarts the project on [server] and,
+    // for servers with a readiness check, waits until the service is ready
+    // to take traffic. Writes the time from issuing the start/restart until
+    // the service was ready into [time_to_ready].
+    // Instances are restarted one at a time (rolling), each one has to be
+    // ready before the next one goes down.
+    // Returns false if the service didn't get ready within the timeout.
+    bool start_service(
+        const Server& server,
+        bool restart,
+        std::chrono::milliseconds& time_to_ready) const;
+
+    // Sets the transfer settings of [server] to what suits the link to it
+    // (see Link, measured once a day) unless they are set in the config.
+    void tune_transfer(Server& server) const;
+
+    // Classifies [changed_paths] (relative to the working directory) with
+    // the restart/reload/ignore path rules: a path matching restart_paths
+    // needs a restart, one matching reload_paths a reload (if the service
+    // has a reload_signal) and one matching ignore_paths nothing. Any other
+    // path needs a restart to be safe. Returns the most disruptive action.
+    ChangeAction classify_changes(const std::vector<std::string>& changed_paths) const;
+
+    // Applies the cheapest safe action for [changed_paths] to the service
+    // on [server] (see classify_changes()) and writes it into [action].
+    // Jobs never need an action since they use the new files on their next run.
+    bool apply_changes(
+        const Server& server,
+        const std::vector<std::string>& changed_paths,
+        ChangeAction& action,
+        std::chrono::milliseconds& time_to_ready) const;
+
+    // time it took the service to get ready in the last setup_server()
+    std::chrono::milliseconds get_time_to_ready() const
+    {
+        return this->time_to_ready;
+    }
+
     void set_project_description(const std::string& project_description)
     {
         this->project_description = asyd::util::strip_newline(project_description);
@@ -78,6 +193,152 @@ public:
         this->schedule = asyd::util::strip_newline(schedule);
     }
 
+    void set_randomized_delay_sec(const std::string& randomized_delay_sec)
+    {
+        this->randomized_delay_sec = asyd::util::strip_newline(randomized_delay_sec);
+    }
+
+    void set_accuracy_sec(const std::string& accuracy_sec)
+    {
+        this->accuracy_sec = asyd::util::strip_newline(accuracy_sec);
+    }
+
+    void set_persistent(const std::string& persistent)
+    {
+        this->persistent = asyd::util::strip_newline(persistent);
+    }
+
+    // fraction of the schedule interval after which a run counts as an overrun
+    void set_overrun_fraction(const std::string& overrun_fraction)
+    {
+        this->overrun_fraction = asyd::util::strip_newline(overrun_fraction);
+    }
+
+    void set_listen_stream(const std::string& listen_stream)
+    {
+        this->listen_stream = asyd::util::strip_newline(listen_stream);
+    }
+
+    void set_idle_timeout_sec(const std::string& idle_timeout_sec)
+    {
+        this->idle_timeout_sec = asyd::util::strip_newline(idle_timeout_sec);
+    }
+
+    // "notify", "tcp:[host:]port" or an http(s):// health URL
+    void set_readiness(const std::string& readiness)
+    {
+        this->readiness = asyd::util::strip_newline(readiness);
+    }
+
+    void set_readiness_timeout_sec(const std::string& readiness_timeout_sec)
+    {
+        this->readiness_timeout_sec = asyd::util::strip_newline(readiness_timeout_sec);
+    }
+
+    void set_relay_hostname(const std::string& relay_hostname)
+    {
+        this->relay_hostname = asyd::util::strip_newline(relay_hostname);
+    }
+
+    // comma-separated hostnames
+    void set_relay_targets(const std::string& relay_targets)
+    {
+        this->relay_targets = asyd::util::strip_newline(relay_targets);
+    }
+
+    void set_relay_fanout(const std::string& relay_fanout)
+    {
+        this->relay_fanout = asyd::util::strip_newline(relay_fanout);
+    }
+
+    // comma-separated globs relative to the working directory, e.g., "static/*"
+    void set_restart_paths(const std::string& restart_paths)
+    {
+        this->restart_paths = asyd::util::strip_newline(restart_paths);
+    }
+
+    void set_reload_paths(const std::string& reload_paths)
+    {
+        this->reload_paths = asyd::util::strip_newline(reload_paths);
+    }
+
+    void set_ignore_paths(const std::string& ignore_paths)
+    {
+        this->ignore_paths = asyd::util::strip_newline(ignore_paths);
+    }
+
+    // signal that makes the service reload, e.g., HUP
+    void set_reload_signal(const std::string& reload_signal)
+    {
+        this->reload_signal = asyd::util::strip_newline(reload_signal);
+    }
+
+    void set_instances(const std::string& instances)
+    {
+        this->instances = asyd::util::strip_newline(instances);
+    }
+
+    // port of instance 0, instance i gets ASYD_PORT = base_port + i
+    void set_base_port(const std::string& base_port)
+    {
+        this->base_port = asyd::util::strip_newline(base_port);
+    }
+
+    // "true" to pin instance i to CPU i (modulo the number of CPUs)
+    void set_pin_instances(const std::string& pin_instances)
+    {
+        this->pin_instances = asyd::util::strip_newline(pin_instances);
+    }
+
+    // "none", a level from 1 to 9 or empty to choose by the link
+    void set_compression(const std::string& compression)
+    {
+        this->compression = asyd::util::strip_newline(compression);
+    }
+
+    // ssh cipher(s) or empty to choose by the link
+    void set_cipher(const std::string& cipher)
+    {
+        this->cipher = asyd::util::strip_newline(cipher);
+    }
+
+    // number of parallel rsync streams or empty to choose by the link
+    void set_transfer_streams(const std::string& transfer_streams)
+    {
+        this->transfer_streams = asyd::util::strip_newline(transfer_streams);
+    }
+
+    // "urgent", "normal" (default) or "bulk" (see BandwidthScheduler)
+    void set_transfer_priority(const std::string& transfer_priority)
+    {
+        this->transfer_priority = asyd::util::strip_newline(transfer_priority);
+    }
+
+    // comma-separated projects that have to be (re)started before this
+    // one when they're deployed together (see deploy_projects())
+    void set_depends_on(const std::string& depends_on)
+    {
+        this->depends_on = asyd::util::strip_newline(depends_on);
+    }
+
+    // shell command run in the working directory before deploys (see Builder)
+    void set_build_command(const std::string& build_command)
+    {
+        this->build_command = asyd::util::strip_newline(build_command);
+    }
+
+    // comma-separated globs of the files the build reads, empty for all
+    void set_build_inputs(const std::string& build_inputs)
+    {
+        this->build_inputs = asyd::util::strip_newline(build_inputs);
+    }
+
+    // file or directory the build writes, relative to the working directory
+    void set_build_output(const std::string& build_output)
+    {
+        this->build_output = asyd::util::strip_newline(build_output);
+    }
+
     void set_project_name(const std::string& project_name)
     {
         this->project_name = asyd::util::strip_newline(project_name);
@@ -93,6 +354,12 @@ public:
         this->server_bash_directory = asyd::util::strip_newline(server_bash_directory);
     }
 
+    // config key -> value of the resource controls that are set
+    const std::map<std::string, std::string>& get_resource_controls() const
+    {
+        return this->resource_controls;
+    }
+
     const std::string& get_project_description() const
     {
         return this->project_description;
@@ -123,6 +390,194 @@ public:
         return this->schedule;
     }
 
+    const std::string& get_randomized_delay_sec() const
+    {
+        return this->randomized_delay_sec;
+    }
+
+    const std::string& get_accuracy_sec() const
+    {
+        return this->accuracy_sec;
+    }
+
+    const std::string& get_persistent() const
+    {
+        return this->persistent;
+    }
+
+    // defaults to 0.8, also for anything but a positive number
+    double get_overrun_fraction() const
+    {
+        double fraction = asyd::util::parse_positive_double(this->overrun_fraction);
+        return fraction > 0 ? fraction : 0.8;
+    }
+
+    const std::string& get_listen_stream() const
+    {
+        return this->listen_stream;
+    }
+
+    const std::string& get_idle_timeout_sec() const
+    {
+        return this->idle_timeout_sec;
+    }
+
+    const std::string& get_readiness() const
+    {
+        return this->readiness;
+    }
+
+    // defaults to 30 seconds, also for anything but a positive number of
+    // seconds (0 would wait forever, "1min" isn't understood)
+    int get_readiness_timeout() const
+    {
+        int timeout_sec = asyd::util::parse_positive_int(this->readiness_timeout_sec);
+        return timeout_sec > 0 ? timeout_sec : 30;
+    }
+
+    const std::string& get_relay_hostname() const
+    {
+        return this->relay_hostname;
+    }
+
+    // all hosts a relay deploy goes to: the server_hostname
+    // followed by the relay_targets
+    std::vector<std::string> get_relay_targets() const
+    {
+        std::vector<std::string> targets = { this->server_hostname };
+        for (const std::string& target : asyd::util::split(this->relay_targets, ','))
+            if (target != this->server_hostname)
+                targets.push_back(target);
+
+        return targets;
+    }
+
+    std::vector<std::string> get_depends_on() const
+    {
+        return asyd::util::split(this->depends_on, ',');
+    }
+
+    const std::string& get_build_command() const
+    {
+        return this->build_command;
+    }
+
+    const std::string& get_build_inputs() const
+    {
+        return this->build_inputs;
+    }
+
+    const std::string& get_build_output() const
+    {
+        return this->build_output;
+    }
+
+    // number of targets each host forwards to per round,
+    // 0 (default) means the relay sends to all targets itself
+    int get_relay_fanout() const
+    {
+        int64_t relay_fanout = asyd::util::parse_counter(this->relay_fanout);
+        return relay_fanout > 0 && relay_fanout <= INT32_MAX ? static_cast<int>(relay_fanout) : 0;
+    }
+
+    const std::string& get_reload_signal() const
+    {
+        return this->reload_signal;
+    }
+
+    // number of instances of a server, defaults to 1
+    int get_instances() const
+    {
+        int64_t instances = asyd::util::parse_counter(this->instances);
+        return instances > 1 && instances <= INT32_MAX ? static_cast<int>(instances) : 1;
+    }
+
+    const std::string& get_base_port() const
+    {
+        return this->base_port;
+    }
+
+    bool get_pin_instances() const
+    {
+        return this->pin_instances == "true";
+    }
+
+    // jobs are the projects that run on a schedule
+    bool is_job() const
+    {
+        return this->schedule.length() > 0;
+    }
+
+    // socket-activated servers are started by their .socket
+    bool is_socket_activated() const
+    {
+        return !this->is_job() && this->listen_stream.length() > 0;
+    }
+
+    // servers with several instances run them from a template unit
+    // (asyd-project@.service) as asyd-project@0.service, asyd-project@1.service, ...
+    bool is_templated() const
+    {
+        return !this->is_job() && !this->is_socket_activated() && this->get_instances() > 1;
+    }
+
+    // name of the project's .service file
+    std::string get_service_file() const
+    {
+        if (this->is_templated())
+            return this->project_name + "@.service";
+
+        return this->project_name + ".service";
+    }
+
+    std::string get_instance_unit(int instance) const
+    {
+        return this->project_name + "@" + std::to_string(instance) + ".service";
+    }
+
+    // the units that are restarted for the project: the activation units,
+    // except for socket-activated servers where only the service is
+    // restarted so the socket keeps accepting connections
+    std::vector<std::string> get_restart_units() const
+    {
+        if (this->is_socket_activated())
+            return { this->project_name + ".service" };
+
+        return this->get_activation_units();
+    }
+
+    // the units that are enabled/started/stopped for the project:
+    // the .timer for jobs, the .socket for socket-activated servers,
+    // every instance of templated servers and the .service otherwise
+    std::vector<std::string> get_activation_units() const
+    {
+        if (this->is_job())
+            return { this->project_name + ".timer" };
+
+        if (this->is_socket_activated())
+            return { this->project_name + ".socket" };
+
+        if (this->is_templated())
+        {
+            std::vector<std::string> units;
+            for (int instance = 0; instance < this->get_instances(); ++instance)
+                units.push_back(this->get_instance_unit(instance));
+            return units;
+        }
+
+        return { this->project_name + ".service" };
+    }
+
+    // the unit(s) whose status is shown, a pattern for all instances
+    // of templated servers
+    std::string get_status_unit() const
+    {
+        if (this->is_templated())
+            return this->project_name + "@*.service";
+
+        return this->project_name + ".service";
+    }
+
     const std::string& get_project_name() const
     {
         return this->project_name;
@@ -152,6 +607,67 @@ private:
     std::string entry_point;            // -e
     std::string schedule;               // -s
 
+    // timer settings of jobs
+    std::string randomized_delay_sec;   // --randomized-delay-sec
+    std::string accuracy_sec;           // --accuracy-sec
+    std::string persistent;             // --persistent
+    std::string overrun_fraction;       // --overrun-fraction
+
+    // socket activation settings of servers
+    std::string listen_stream;          // --listen-stream
+    std::string idle_timeout_sec;       // --idle-timeout-sec
+
+    // readiness check of servers
+    std::string readiness;              // --readiness
+    std::string readiness_timeout_sec;  // --readiness-timeout-sec
+
+    // distribution through a relay host (see Relay)
+    std::string relay_hostname;         // --relay-hostname
+    std::string relay_targets;          // --relay-targets
+    std::string relay_fanout;           // --relay-fanout
+
+    // rules for which action changed files need (see classify_changes())
+    std::string restart_paths;          // --restart-paths
+    std::string reload_paths;           // --reload-paths
+    std::string ignore_paths;           // --ignore-paths
+    std::string reload_signal;          // --reload-signal
+
+    // several instances of a server (see is_templated())
+    std::string instances;              // --instances
+    std::string base_port;              // --base-port
+    std::string pin_instances;          // --pin-instances
+
+    // transfer settings, empty ones are chosen by the link (see tune_transfer())
+    std::string compression;            // --compression
+    std::string cipher;                 // --cipher
+    std::string transfer_streams;       // --transfer-streams
+    std::string transfer_priority;      // --transfer-priority
+
+    // order of group deploys
+    std::string depends_on;             // --depends-on
+
+    // local build before deploys
+    std::string build_command;          // --build-command
+    std::string build_inputs;           // --build-inputs
+    std::string build_output;           // --build-output
+
+    std::chrono::milliseconds time_to_ready{0};
+
+    // resource-control/CPU-placement settings (see Systemd::RESOURCE_CONTROLS)
+    std::map<std::string, std::string> resource_controls;
+
     std::unordered_map<std::string, key_action_fptr> key_action;
+
+    // shell command that succeeds once [instance] of the service is ready
+    // (empty if there is nothing to probe); tcp: ports are offset by the
+    // instance like ASYD_PORT
+    std::string readiness_probe(int instance) const;
+
+    // starts/restarts a single unit and waits until it's ready
+    bool start_unit(
+        const Server& server,
+        bool restart,
+        const std::string& unit_name,
+        int instance) const;
 }; // class Config
 }; // namespace asyd
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "server.hpp"
+
+namespace asyd
+{
+// The recent runs of a job, reconstructed from the service manager's
+// journal messages about its service (see Server::fetch_job_history()),
+// and how long they take compared to the job's schedule interval.
+// Values systemd didn't record (e.g., the exit status on older versions
+// or the memory peak before systemd 255) are -1.
+class JobHistory
+{
+public:
+    struct Run
+    {
+        int64_t started_us = 0;         // realtime, microseconds
+        int64_t finished_us = 0;        // 0 while the run is still going
+        bool succeeded = false;
+        int exit_status = -1;           // -1 if unknown or killed by a signal
+        std::string exit_code;          // "exited", "killed", "dumped", ...
+        int64_t cpu_usage_nsec = -1;
+        int64_t memory_peak_bytes = -1;
+        int64_t io_read_bytes = -1;
+        int64_t io_write_bytes = -1;
+
+        bool is_running() const
+        {
+            return this->finished_us == 0;
+        }
+    };
+
+    JobHistory(const std::string& service_name, const std::string& schedule);
+
+    // Fetches (at most) the last [max_runs] runs with a single ssh call.
+    // Returns false if the server couldn't be reached.
+    bool fetch(const Server& server, size_t max_runs);
+
+    // oldest first, the last one may still be running
+    const std::vector<Run>& get_runs() const;
+
+    // seconds between two scheduled runs (from the server's systemd, or the
+    // median gap between the runs' starts), 0 if unknown
+    int64_t get_interval_sec() const;
+
+    // duration of [run] in seconds (until now if it's still running)
+    double get_duration_sec(const Run& run) const;
+
+    // the [percentile] (0-100) of the finished runs' durations in
+    // seconds, -1 if there are none
+    double get_duration_percentile(double percentile) const;
+
+    // true if [run] took (or, still running, takes) longer than
+    // [fraction] of the schedule interval
+    bool is_overrun(const Run& run, double fraction) const;
+
+private:
+    std::string service_name;
+    std::string schedule;
+
+    std::vector<Run> runs;
+    int64_t interval_sec = 0;
+    int64_t now_us = 0;
+
+    // turns the output of Server::fetch_job_history() into runs
+    void parse(const std::string& output, size_t max_runs);
+}; // class JobHistory
+}; // namespace asyd
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "libasyd_types.hpp"
+
+namespace asyd
+{
+enum class ErrorCode
+{
+    OK = 0,
+    PROJECT_NOT_FOUND,      // no local config for the project
+    INVALID_CONFIG,         // the config file couldn't be parsed
+    NOT_LOADED,             // operation on a project that wasn't loaded
+    TRANSFER_FAILED,        // copying files to the server failed
+    SERVICE_ACTION_FAILED,  // systemctl failed or the service didn't get ready
+    STATUS_FAILED,          // the status couldn't be fetched
+    CONNECTION_FAILED,      // the server couldn't be reached
+    TARGETS_FAILED,         // some hosts failed (see Result::target_results)
+    DEPENDENCY_FAILED,      // a project this one depends on failed to deploy
+    BUILD_FAILED,           // the local build command failed
+    NOTHING_STAGED,         // activate() without a staged version
+    SCAN_FAILED,            // the working directory couldn't be read or has no files
+};
+
+// Outcome of an operation on a project.
+struct Result
+{
+    ErrorCode error_code = ErrorCode::OK;
+
+    // describes the error (empty on success)
+    std::string message;
+
+    // output of the operation, e.g., the status
+    std::string output;
+
+    // total duration of the operation
+    std::chrono::milliseconds duration{0};
+
+    // time until the service was ready (start/restart/deploy of servers)
+    std::chrono::milliseconds time_to_ready{0};
+
+    // what a deploy did to the running service
+    ChangeAction change_action = ChangeAction::RESTART;
+
+    // what the local build step did before a deploy
+    BuildOutcome build_outcome = BuildOutcome::NOT_CONFIGURED;
+
+    // per-host results of operations on several hosts (e.g., relay deploys)
+    std::vector<TargetResult> target_results;
+
+    bool ok() const
+    {
+        return this->error_code == ErrorCode::OK;
+    }
+};
+
+// In-process API to operate on asyd projects (this is what the asyd
+// executable uses as well). A project is loaded once and can then be used
+// for any number of operations without re-reading its config.
+class Project
+{
+public:
+    Project();
+    Project(const Project& other);
+    Project& operator=(const Project& other);
+    ~Project();
+
+    // Loads the project from ~/.asyd/[project_name]
+    Result load(const std::string& project_name);
+
+    // Copies the changed files to the server, updates the systemd files if
+    // they changed and restarts/reloads the service as needed (jobs aren't
+    // restarted, they use the new files on their next run). Only the
+    // remote steps that are needed run (see Planner).
+    // Projects with a relay_hostname are deployed to all relay targets
+    // through the relay (see Relay).
+    Result deploy() const;
+
+    // Same as deploy() but calls [before_activation] once the files are on
+    // the server, before the service is restarted/reloaded (e.g., to wait
+    // for other projects). The deploy stops there with DEPENDENCY_FAILED
+    // if it returns false; the next deploy then also restarts/reloads for
+    // the files copied this time. Relay deploys call it before they start.
+    Result deploy(const std::function<bool()>& before_activation) const;
+
+    // First half of a two-phase deploy: copies the next version (only the
+    // files that changed) into a staging directory next to the project's
+    // directory on the server and verifies it against the local files,
+    // without touching the running service.
+    Result stage() const;
+
+    // Second half: switches the project's directory to the staged version
+    // (a rename, independent of the size of the project), updates the
+    // systemd files if they changed and restarts/reloads the service as
+    // the staged files need it. The previous version is kept next to it
+    // until the next stage(). Not available for relay projects.
+    Result activate() const;
+
+    // Dry-run of deploy(): writes the steps a deploy would run
+    // into Result::output (one per line), without running them.
+    Result plan() const;
+
+    Result start() const;
+    Result stop() const;
+    Result restart() const;
+
+    // Fetches the systemctl status of the service into Result::output
+    Result status() const;
+
+    // Runs the operation on a separate thread. The project must outlive
+    // the returned future.
+    std::future<Result> deploy_async() const;
+    std::future<Result> restart_async() const;
+
+    // Overrides a setting (config key) of the loaded project for the
+    // following operations, without changing its config file.
+    // Returns false for unknown keys and invalid values.
+    bool set_setting(const std::string& key, const std::string& value);
+
+    // of the loaded project
+    const std::string& get_hostname() const;
+    std::vector<std::string> get_depends_on() const;
+    bool is_job() const;
+
+private:
+    // the config and server of the loaded project, kept out of this header
+    // so the API doesn't change with asyd's internals
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+    // operations fill in the result and return false on failure
+    typedef bool (Project::*operation_fptr)(Result&) const;
+
+    // runs [operation] on a loaded project and measures its duration
+    Result run(operation_fptr operation) const;
+
+    bool run_deploy(Result& result) const;
+    bool run_staged_deploy(Result& result, const std::function<bool()>& before_activation) const;
+    bool run_relay_deploy(Result& result) const;
+    bool run_plan(Result& result) const;
+    bool run_stage(Result& result) const;
+    bool run_activate(Result& result) const;
+    bool run_start(Result& result) const;
+    bool run_stop(Result& result) const;
+    bool run_restart(Result& result) const;
+    bool run_status(Result& result) const;
+
+    static bool fail(Result& result, ErrorCode error_code, const std::string& message);
+}; // class Project
+
+// Names of all local projects that match any of [patterns], which can
+// be project names or shell globs (e.g., "api-*"). Sorted by name.
+std::vector<std::string> find_projects(const std::vector<std::string>& patterns);
+
+// Starts/stops/restarts ([action]) all projects matching [patterns].
+// The units are grouped by host and each host gets a single systemctl
+// call for all of its units (hosts run in parallel); readiness checks
+// are not waited on. The state of each unit is in Result::target_results.
+Result service_action(const std::vector<std::string>& patterns, const std::string& action);
+
+// Deploys all projects matching [patterns] together, ordered by their
+// depends_on (among the matching projects, others are assumed to be
+// running): all transfers run right away in parallel, only the
+// restart/reload of a project waits until the projects it depends on
+// were activated. A project whose dependency failed isn't activated.
+// Fails with INVALID_CONFIG on circular dependencies. The outcome of each
+// project is in Result::target_results, in the order they were activated.
+Result deploy_projects(const std::vector<std::string>& patterns);
+}; // namespace asyd
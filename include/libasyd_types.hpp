@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+
+// Types of the in-process API (see libasyd.hpp), shared with the
+// internals that produce them. Only the standard library is included
+// here so the API doesn't pull in asyd's internal headers.
+namespace asyd
+{
+// What a deploy has to do to the running service for a set of changed
+// files, from cheapest to most disruptive.
+enum class ChangeAction
+{
+    NONE,       // e.g., only static files changed
+    RELOAD,     // the service reloads without dropping requests (ExecReload)
+    RESTART,
+};
+
+// What the local build step did before a deploy (see Builder).
+enum class BuildOutcome
+{
+    NOT_CONFIGURED, // the project has no build_command
+    UP_TO_DATE,     // the output is from the current inputs
+    RESTORED,       // the output for the current inputs came from the cache
+    BUILT,
+    FAILED,
+};
+
+// Outcome of an operation on one host (and project).
+struct TargetResult
+{
+    std::string hostname;
+    std::string project_name;
+    bool success = false;
+
+    // describes what failed (empty on success)
+    std::string message;
+
+    std::chrono::milliseconds time_to_ready{0};
+};
+}; // namespace asyd
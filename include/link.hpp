@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <ctime>
+
+#include "server.hpp"
+
+namespace asyd
+{
+// Measured characteristics of the network link to a host, cached in
+// ~/.asyd/.hosts/<hostname>, and the transfer settings that suit them.
+class Link
+{
+public:
+    // measurements older than this are taken again
+    static const int MAX_AGE_SEC = 24 * 60 * 60;
+
+    Link(const std::string& hostname);
+
+    // Loads the cached measurements.
+    // Returns false if there are none or they are older than MAX_AGE_SEC.
+    bool load();
+
+    // Measures the round trip and the upload throughput over [server]'s
+    // connection and caches them.
+    bool measure(const Server& server);
+
+    // Compression for slow links, a fast cipher for fast links and several
+    // streams for links with a high round trip.
+    TransferSettings choose() const;
+
+    std::chrono::microseconds get_round_trip() const
+    {
+        return this->round_trip;
+    }
+
+    // bytes per second
+    double get_throughput() const
+    {
+        return this->throughput;
+    }
+
+    std::time_t get_measured_at() const
+    {
+        return this->measured_at;
+    }
+
+private:
+    std::string hostname;
+    std::chrono::microseconds round_trip{0};
+    double throughput = 0;
+    std::time_t measured_at = 0;
+
+    std::string cache_path() const;
+    bool save() const;
+}; // class Link
+}; // namespace asyd
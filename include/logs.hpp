@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+#include "server.hpp"
+
+namespace asyd
+{
+// Streams the journals of several services on several hosts at once and
+// merges them into a single time-ordered stream. Every source's journal
+// is in order, so an entry is passed on once every other source has
+// either buffered an entry, moved past its time or ended (k-way merge).
+// Sources that are silent for longer than the reorder window don't hold
+// up the others. Every source buffers a bounded number of entries and
+// stops reading while its buffer is full, so memory stays bounded.
+class LogMerger
+{
+public:
+    struct Entry
+    {
+        int64_t timestamp_us = 0;   // unix time in microseconds
+        std::string source;         // label of the source
+        std::string message;
+    };
+
+    // Passes the journal lines of a source ("<seconds>.<microseconds>
+    // <message>", as journalctl -o short-unix writes them) to [on_line]
+    // until they end or [on_line] returns false (see Server::stream_journal()).
+    typedef std::function<void(
+        int lines,
+        bool follow,
+        const std::function<bool(const std::string&)>& on_line,
+        const std::atomic<bool>* cancelled)> reader_fn;
+
+    LogMerger(
+        std::chrono::milliseconds reorder_window = std::chrono::milliseconds(500),
+        size_t max_buffered_entries = 1000);
+
+    // Streams the journal of [service_names] on [server], labeling its
+    // entries with [label].
+    void add_source(
+        const Server& server,
+        const std::vector<std::string>& service_names,
+        const std::string& label);
+
+    // Merges the lines [reader] passes on, e.g., a saved journal.
+    void add_source(const reader_fn& reader, const std::string& label);
+
+    // Streams all sources (the last [lines] entries of each and then new
+    // ones if [follow]) and calls [on_entry] in time order until all
+    // sources ended or [keep_running] returns false.
+    void run(
+        int lines,
+        bool follow,
+        const std::function<void(const Entry&)>& on_entry,
+        const std::function<bool()>& keep_running);
+
+private:
+    struct Source
+    {
+        reader_fn reader;
+        std::string label;
+
+        std::deque<Entry> entries;
+        std::deque<std::chrono::steady_clock::time_point> arrivals;
+        int64_t last_timestamp_us = 0;
+        bool ended = false;
+
+        // columns journalctl indents the continuation lines of the last
+        // multi-line message by (the width of its prefix)
+        size_t continuation_indent = 0;
+    };
+
+    std::chrono::milliseconds reorder_window;
+    size_t max_buffered_entries;
+
+    std::vector<std::unique_ptr<Source>> sources;
+
+    std::mutex mutex;
+    std::condition_variable entries_changed;
+    std::atomic<bool> cancelled{false};
+
+    // reads the journal of [source] until it ends or the merge is cancelled
+    void read_source(Source& source, int lines, bool follow);
+
+    // the source whose next entry can be passed on, null if none
+    Source* next_source(std::chrono::steady_clock::time_point now) const;
+}; // class LogMerger
+}; // namespace asyd
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace asyd
+{
+// Declares many projects in one file, one section per project with the
+// same key=value settings as a project's config.cfg:
+//
+//   # settings before the first section apply to all projects
+//   server_hostname=deploy@web-1
+//
+//   [api]
+//   working_directory=/home/me/api
+//   entry_point=build/start.sh
+//
+//   [nightly-report]
+//   server_hostname=deploy@web-2
+//   working_directory=/home/me/reports
+//   entry_point=run.sh
+//   schedule=*-*-* 03:00:00
+//
+// Empty lines and lines starting with '#' are skipped.
+class Manifest
+{
+public:
+    struct Project
+    {
+        std::string name;
+        size_t line = 0;    // of the section header
+
+        // in the order they're applied: the defaults, then the project's
+        std::vector<std::pair<std::string, std::string>> settings;
+    };
+
+    // Reads and validates the manifest (unknown keys, missing required
+    // settings, duplicate projects).
+    // Returns false on the first error, see get_error().
+    bool from_file(const std::string& filepath);
+
+    const std::vector<Project>& get_projects() const
+    {
+        return this->projects;
+    }
+
+    const std::string& get_error() const
+    {
+        return this->error;
+    }
+
+private:
+    std::vector<Project> projects;
+    std::string error;
+
+    bool fail(size_t line, const std::string& message);
+}; // class Manifest
+}; // namespace asyd
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include "server.hpp"
+
+namespace asyd
+{
+// Samples the resource usage of all asyd services on a set of hosts with
+// a single systemctl call per host and turns consecutive samples into
+// rates. Values systemd doesn't account (e.g., IO without IOAccounting)
+// are -1.
+class Monitor
+{
+public:
+    struct UnitStats
+    {
+        std::string hostname;
+        std::string unit_name;          // without the asyd- prefix
+        std::string state;              // ActiveState
+        double cpu_percent = -1;        // of one core, since the last sample
+        int64_t memory_bytes = -1;
+        int64_t tasks = -1;
+        double io_read_rate = -1;       // bytes per second
+        double io_write_rate = -1;
+        int64_t restarts = -1;
+    };
+
+    // The servers keep a persistent connection while the monitor is open
+    // (see open()), so sampling every few seconds stays cheap.
+    void add_server(const Server& server);
+
+    bool open();
+    void close();
+
+    // Samples all hosts in parallel and writes the units of the hosts that
+    // could be reached into [stats] (rates need a previous sample, until
+    // then they are -1). Returns the number of hosts that couldn't be reached.
+    size_t sample(std::vector<UnitStats>& stats);
+
+private:
+    struct Counters
+    {
+        double uptime = 0;              // seconds, from the host's /proc/uptime
+        int64_t cpu_usage_nsec = -1;
+        int64_t io_read_bytes = -1;
+        int64_t io_write_bytes = -1;
+    };
+
+    std::vector<Server> servers;
+
+    // hostname|unit -> counters of the previous sample
+    std::map<std::string, Counters> previous;
+
+    // parses the output of one host into [stats] and updates the counters
+    void parse_sample(
+        const std::string& hostname,
+        const std::string& output,
+        std::vector<UnitStats>& stats);
+}; // class Monitor
+}; // namespace asyd
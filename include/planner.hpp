@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+namespace asyd
+{
+// forward declarations
+class Config;
+class Server;
+enum class ChangeAction;
+
+// Brings a project on its server to the state described by its config
+// while only running the remote steps that are actually needed: files are
+// only copied if the tree differs, systemd files only if their content
+// differs, daemon-reload only runs if a systemd file was copied and the
+// service is only enabled/started/restarted if it has to be.
+class Planner
+{
+public:
+    enum class StepType
+    {
+        CREATE_DIRECTORY,
+        COPY_FILES,
+        COPY_SYSTEMD_FILE,
+        RELOAD_DAEMON,
+        ENABLE,
+        START,
+        RESTART,        // a systemd file of the running service changed
+        APPLY_CHANGES,  // restart/reload/nothing depending on the changed files
+    };
+
+    struct Step
+    {
+        StepType type;
+        std::string target;
+    };
+
+    Planner(const Config& config, const Server& server, const std::string& config_directory);
+
+    // Plans (and copies the files) against [directory] on the server
+    // instead of the project's directory, e.g., a staging directory.
+    void set_server_project_dir(const std::string& directory);
+
+    // Regenerates the local systemd files, fetches the state of the project
+    // on the server (in a single ssh call) and plans the needed steps.
+    // Returns false if the working directory couldn't be scanned (or has no
+    // files) or the server couldn't be reached (see get_error()).
+    bool plan();
+
+    // why plan() failed
+    const std::string& get_error() const
+    {
+        return this->error;
+    }
+
+    // true if plan() failed on the local working directory
+    bool is_scan_error() const
+    {
+        return this->scan_error;
+    }
+
+    const std::vector<Step>& get_steps() const
+    {
+        return this->steps;
+    }
+
+    // human-readable description of a step
+    std::string describe(const Step& step) const;
+
+    // Executes the planned steps. Writes what was done to the running
+    // service into [action] and its time-to-ready into [time_to_ready].
+    // Same as transfer() followed by activate().
+    bool execute(ChangeAction& action, std::chrono::milliseconds& time_to_ready);
+
+    // Executes the steps that only put files onto the server (directory,
+    // project files, systemd files) without touching the running service.
+    // Same as transfer_files() followed by transfer_systemd_files().
+    bool transfer();
+
+    // Creates the directory and copies the changed project files.
+    bool transfer_files();
+
+    // Copies the changed systemd files.
+    bool transfer_systemd_files();
+
+    // the files rsync actually transferred in transfer()/transfer_files()
+    const std::vector<std::string>& get_copied_files() const
+    {
+        return this->copied_files;
+    }
+
+    // true if the project's files on the server differ from the local ones
+    bool has_changed_files() const
+    {
+        return !this->changed_files.empty();
+    }
+
+    // true if systemd files are copied (they take effect in activate())
+    bool has_changed_systemd_files() const;
+
+    // Executes the remaining steps (daemon-reload, enable, start/restart
+    // or applying the changes copied by transfer()).
+    bool activate(ChangeAction& action, std::chrono::milliseconds& time_to_ready) const;
+
+private:
+    const Config& config;
+    const Server& server;
+    std::string config_directory;
+    std::string server_project_dir;
+
+    // remote state
+    bool remote_directory_exists = false;
+    std::map<std::string, std::string> remote_systemd_files;
+    std::string remote_enabled;
+    std::string remote_active;
+    std::map<std::string, std::string> remote_manifest;
+
+    std::vector<std::string> changed_files;
+    std::vector<Step> steps;
+
+    std::string error;
+    bool scan_error = false;
+
+    // the files rsync actually transferred in transfer()
+    std::vector<std::string> copied_files;
+
+    void parse_state(const std::string& output);
+
+    // local files that are missing or differ on the server, false if the
+    // working directory couldn't be scanned
+    bool diff_tree();
+
+    // content of a systemd file in [config_directory] without empty lines
+    std::string read_systemd_file(const std::string& name) const;
+}; // class Planner
+}; // namespace asyd
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "libasyd_types.hpp"
+
+namespace asyd
+{
+// forward declarations
+class Config;
+class Server;
+
+// Deploys a project to several hosts behind a relay (e.g., a bastion)
+// while uploading the payload over the slow link to the relay only once.
+// The relay distributes it over the internal network, either to all
+// targets itself or as a tree where every host that received the payload
+// forwards it to [relay_fanout] more targets per round. Targets are
+// reached through the relay (ssh -J) and forward with the local agent
+// (ssh -A), so all hosts have to accept the local key.
+class Relay
+{
+public:
+    Relay(const Config& config);
+
+    // Uploads the working directory to the relay, distributes it to all
+    // targets and restarts the service on every target.
+    // Writes one result per target into [results].
+    // Returns false if the upload to the relay failed.
+    bool deploy(std::vector<TargetResult>& results) const;
+
+private:
+    const Config& config;
+
+    // staging directory on the relay (relative to its home directory)
+    std::string relay_path() const;
+
+    // project directory on the targets (relative to their home directory)
+    std::string project_path() const;
+
+    Server target_server(const std::string& hostname) const;
+
+    // copies the payload from the relay to all targets
+    void distribute(std::vector<TargetResult>& results) const;
+
+    // installs the systemd files and restarts the service on a target
+    void activate(TargetResult& result) const;
+}; // class Relay
+}; // namespace asyd
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+namespace asyd
+{
+// Scans a local tree with several threads and keeps a persistent cache of
+// every regular file's inode, size, mtime and content hash, so files that
+// didn't change since the last scan are neither re-read nor re-hashed.
+// Symlinks are skipped like in the deploy manifest.
+class Scanner
+{
+public:
+    struct Entry
+    {
+        uint64_t inode = 0;
+        int64_t size = 0;
+        int64_t mtime_ns = 0;
+        uint64_t hash = 0;      // FNV-1a of the content
+        bool hashed = false;    // false if the file was only stat'ed
+
+        // whole seconds, as compared with the remote manifest
+        int64_t get_mtime_sec() const
+        {
+            return this->mtime_ns / 1000000000;
+        }
+    };
+
+    struct Stats
+    {
+        size_t files = 0;
+        size_t files_hashed = 0;
+        uint64_t bytes_hashed = 0;
+        std::chrono::milliseconds duration{0};
+    };
+
+    // [cache_path] is the file the cache is loaded from and saved to
+    Scanner(const std::string& root_directory, const std::string& cache_path);
+
+    // Walks the tree and updates the entries (and the cache file). With
+    // [hash_files], new and modified files (or those never hashed) are
+    // hashed in parallel, otherwise only their stat is refreshed.
+    // [threads] = 0 uses one thread per core.
+    // Returns false if the root directory or one below it couldn't be read.
+    bool scan(bool hash_files = true, unsigned int threads = 0);
+
+    // Only hashes the files (relative paths) [filter] returns true for,
+    // e.g., when only some of the files matter.
+    void set_hash_filter(const std::function<bool(const std::string&)>& filter)
+    {
+        this->hash_filter = filter;
+    }
+
+    // relative path -> entry of every regular file found by the last scan
+    const std::map<std::string, Entry>& get_entries() const;
+
+    const Stats& get_stats() const;
+
+    // total size of the entries found by the last scan
+    uint64_t get_total_size() const;
+
+    // Combined hash of all entries' paths and content hashes, only of the
+    // paths [include] returns true for if given (requires a scan with
+    // [hash_files]).
+    uint64_t get_tree_hash(const std::function<bool(const std::string&)>& include = nullptr) const;
+
+private:
+    std::string root_directory;
+    std::string cache_path;
+
+    std::map<std::string, Entry> entries;
+    Stats stats;
+    std::function<bool(const std::string&)> hash_filter;
+
+    bool load_cache();
+    bool save_cache() const;
+
+    // relative path -> stat'ed entry of all regular files
+    bool walk(unsigned int threads, std::map<std::string, Entry>& found) const;
+
+    // FNV-1a over the file's content, false if it couldn't be read
+    static bool hash_file(const std::string& path, uint64_t& hash);
+}; // class Scanner
+}; // namespace asyd
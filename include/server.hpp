@@ -2,9 +2,29 @@
 
 #include <string>
 #include <cstring>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <functional>
+
+#include "bandwidth.hpp"
 
 namespace asyd
 {
+// forward declarations
+class Command;
+
+// How files are transferred to a server (see Link::choose())
+struct TransferSettings
+{
+    int compression_level = 0;  // 0 for no compression
+    std::string ciphers;        // ssh -c preference list, empty for ssh's default
+    int streams = 1;            // parallel rsync processes for file lists
+
+    // priority of the transfers in the BandwidthScheduler
+    BandwidthScheduler::Priority priority = BandwidthScheduler::Priority::NORMAL;
+};
+
 class Server
 {
 public:
@@ -15,6 +35,34 @@ public:
 
     void set_is_root(bool is_root);
 
+    // Connects to the server through [jump_host] (ssh -J), e.g., a bastion.
+    void set_jump_host(const std::string& jump_host);
+
+    // Compression and cipher apply to all following ssh/rsync commands
+    // (set them before open_connection()), streams to copying file lists.
+    void set_transfer_settings(const TransferSettings& transfer_settings);
+    const TransferSettings& get_transfer_settings() const;
+
+    // Server directory (absolute) with the running version of what's
+    // copied: files unchanged against it are hard linked from it instead
+    // of copied, changed ones are new files, so nothing it shares with the
+    // copy is modified. Empty (the default) copies everything.
+    void set_link_dest(const std::string& link_dest);
+
+    // Opens a persistent (multiplexed) ssh connection to the server which
+    // all following ssh/rsync commands of this object reuse, avoiding a
+    // new handshake per command.
+    bool open_connection();
+    void close_connection();
+    bool is_connected() const;
+
+    // Measures the round trip of a no-op command over the connection
+    // (the fastest of [samples]) into [round_trip].
+    bool measure_round_trip(int samples, std::chrono::microseconds& round_trip) const;
+
+    // Measures how long uploading [bytes] of random data takes into [duration].
+    bool measure_upload(size_t bytes, std::chrono::microseconds& duration) const;
+
     // Fetches the service user's home directory
     // and the server's bash directory needed to
     // create the systemd service file
@@ -23,38 +71,209 @@ public:
     bool create_directory(const std::string& path) const;
     bool remove_directory(const std::string& path) const;
 
+    // removes all of [paths] in a single ssh call
+    bool remove_directory(const std::vector<std::string>& paths) const;
+
+    // Replaces [staging_path] with an empty directory for the next version
+    // to be copied into (see set_link_dest()) and removes [previous_path].
+    bool prepare_staging_directory(
+        const std::string& staging_path,
+        const std::string& previous_path) const;
+
+    // Moves [path] to [previous_path] and [staging_path] to [path] in a
+    // single ssh call; two renames, however large the project is.
+    // Returns false if nothing was staged.
+    bool activate_staging_directory(
+        const std::string& path,
+        const std::string& staging_path,
+        const std::string& previous_path) const;
+
+    // Copies a directory from this server to [to_hostname] over the
+    // network of the servers (i.e., the bytes don't pass through here).
+    // This server needs ssh access to [to_hostname]. Paths are relative
+    // to the home directories.
+    bool forward_directory(
+        const std::string& from_server_path,
+        const std::string& to_hostname,
+        const std::string& to_server_path) const;
+
     bool chmod(
         const std::string& chmod_options,
         const std::string& target_file) const;
 
+    // Copies the whole tree, [bytes] is its size for the BandwidthScheduler
+    // (see Scanner::get_total_size()).
     bool copy_from_local(
         const std::string& from_local_path,
-        const std::string& to_server_path) const;
+        const std::string& to_server_path,
+        uint64_t bytes) const;
+
+    // Copies only [relative_paths] (relative to [from_local_path]).
+    // Paths that no longer exist locally are removed from the server.
+    bool copy_from_local(
+        const std::string& from_local_path,
+        const std::string& to_server_path,
+        const std::vector<std::string>& relative_paths) const;
+
+    // Copies the whole tree (including symlinks and empty directories,
+    // nothing is deleted) and writes the paths of the files that actually
+    // changed on the server into [changed_paths]. [relative_paths], the
+    // files known to have changed, are spread over several rsync streams
+    // first if the link calls for them.
+    bool copy_changes_from_local(
+        const std::string& from_local_path,
+        const std::string& to_server_path,
+        const std::vector<std::string>& relative_paths,
+        std::vector<std::string>& changed_paths) const;
 
     bool copy_systemd_file(
         const std::string& local_directory,
         const std::string& service_name) const;
 
     bool reload_service() const;
+
+    // reloads a running service (systemctl try-reload-or-restart)
+    bool reload_unit(const std::string& service_name) const;
     bool enable_service(const std::string& service_name) const;
     bool start_service(const std::string& service_name) const;
     bool stop_service(const std::string& service_name) const;
+
+    // stops and disables a unit (disable --now), keeping the unit file
+    bool disable_service(const std::string& service_name) const;
     bool restart_service(const std::string& service_name) const;
+
+    // stops, disables and deletes a unit, succeeds if it isn't installed
     bool remove_service(const std::string& service_name) const;
+
+    // Runs systemctl [action] on all [service_names] at once and writes
+    // the state of each unit afterwards (systemctl is-active) into [states],
+    // in the same order. Both happen in a single ssh call.
+    // Returns false if the server couldn't be reached.
+    bool bulk_action(
+        const std::string& action,
+        const std::vector<std::string>& service_names,
+        std::vector<std::string>& states) const;
     bool list_services(std::string& output) const;
 
+    // Runs [probe_command] on the server until it succeeds or
+    // [timeout_sec] passed. Returns false on timeout.
+    bool wait_until_ready(const std::string& probe_command, int timeout_sec) const;
+
+    // Fetches everything needed to plan a deploy in a single ssh call and
+    // writes it into [output]: the content of each of [service_names] in
+    // the systemd directory, whether each of [activation_service_names] is
+    // enabled and active, and a manifest ("path|size|mtime") of the files in
+    // [server_project_dir]. Sections are introduced by "@@" lines.
+    bool fetch_state(
+        const std::string& server_project_dir,
+        const std::vector<std::string>& service_names,
+        const std::vector<std::string>& activation_service_names,
+        std::string& output) const;
+
+    // Writes all asyd systemd files on the server (system and user units,
+    // including the symlinks that enable them) into the tar archive
+    // [archive_path] with a single ssh call. Paths in the archive are
+    // relative to / (e.g., etc/systemd/system/asyd-name.service).
+    bool fetch_unit_files(const std::string& archive_path) const;
+
+    // Writes the [properties] (comma-separated) of all loaded units that
+    // match [pattern] (systemctl show, one block per unit separated by an
+    // empty line) into [output], followed by "@@uptime" and the server's
+    // uptime in seconds. All in a single ssh call.
+    bool fetch_unit_properties(
+        const std::string& pattern,
+        const std::string& properties,
+        std::string& output) const;
+
+    // Fetches the history of a job in a single ssh call and writes it into
+    // [output]: the service manager's messages with [message_ids] about
+    // [service_name] (the last [max_entries], journalctl's export format
+    // with only [fields]), the unit's current state and resource usage
+    // ("@@unit", systemctl show), the next two elapses of [schedule]
+    // ("@@schedule", systemd-analyze calendar) and the server's clock
+    // ("@@now", seconds since the epoch).
+    bool fetch_job_history(
+        const std::string& service_name,
+        const std::vector<std::string>& message_ids,
+        const std::string& fields,
+        const std::string& schedule,
+        int max_entries,
+        std::string& output) const;
+
+    // Streams the journal of [service_names] (patterns allowed), starting
+    // with the last [lines] entries and following new ones if [follow],
+    // as "<seconds>.<microseconds> <identifier>[<pid>]: <message>"
+    // lines to [on_line] (see Command::stream()).
+    bool stream_journal(
+        const std::vector<std::string>& service_names,
+        int lines,
+        bool follow,
+        const std::function<bool(const std::string&)>& on_line,
+        const std::atomic<bool>* cancelled) const;
+
+    // Runs the shell [command] in [directory] on the server (killed after
+    // [timeout_sec] if it's positive, exit status 124 then) and calls
+    // [on_line] with every line of its output (stdout and stderr) as it
+    // arrives, see Command::stream(). Writes the exit status into
+    // [exit_status] (255 if the server couldn't be reached, -1 if it
+    // was cancelled).
+    bool run_command(
+        const std::string& directory,
+        const std::string& command,
+        int timeout_sec,
+        const std::function<bool(const std::string&)>& on_line,
+        const std::atomic<bool>* cancelled,
+        int& exit_status) const;
+
     // check the status of a service and write it into [output]
     bool check_status(const std::string& service_name, std::string& output) const;
 
+    const std::string& get_hostname() const;
     const std::string& get_home() const;
     const std::string& get_bash() const;
 
+    // appends the paths of rsync's itemized changes (--out-format='%i %n')
+    // that are files which changed to [changed_paths]
+    static void parse_itemized_changes(const std::string& output, std::vector<std::string>& changed_paths);
+
 private:
     std::string hostname;
     std::string home_directory;
     std::string bash_directory;
 
-    bool is_root;
+    // socket of the persistent connection (empty if not opened)
+    std::string control_path;
+
+    bool is_root = false;
+
+    // host to connect through (empty for a direct connection)
+    std::string jump_host;
+
+    TransferSettings transfer_settings;
+    std::string link_dest;
+
+    // options passed to every ssh command
+    std::string ssh_options() const;
+
+    // start an ssh/rsync command with the connection options of this server
+    Command& ssh(Command& command) const;
+
+    // rsync commands are limited to the bandwidth of their [ticket]
+    Command& rsync(Command& command, const BandwidthScheduler::Ticket& ticket) const;
+
+    // waits for the BandwidthScheduler to let a transfer of [bytes] start
+    BandwidthScheduler::Ticket schedule_transfer(const std::string& description, uint64_t bytes) const;
+
+    // Copies [relative_paths] with up to transfer_settings.streams rsync
+    // processes in parallel. Paths missing locally are deleted on the
+    // server with [delete_missing]; the itemized changes are written into
+    // [changed_paths] if it isn't null.
+    bool copy_file_list(
+        const std::string& from_local_path,
+        const std::string& to_server_path,
+        const std::vector<std::string>& relative_paths,
+        bool delete_missing,
+        std::vector<std::string>* changed_paths) const;
 
     bool systemd_action(const std::string& action, const std::string& service_name) const;
     // filters the output from list_services() to only include the services by asyd
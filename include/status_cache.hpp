@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ctime>
+#include <functional>
+
+namespace asyd
+{
+// Last observed output of a remote read (e.g., a project's status), cached
+// in ~/.asyd/.status/<key> so it can be answered without waiting on the
+// network (stale-while-revalidate): a cached answer is returned right away
+// and, once it's older than REVALIDATE_AFTER_SEC, refreshed by a background
+// process (see set_refresher()) for the next call.
+class StatusCache
+{
+public:
+    // reads the live output into its argument, false if it failed
+    typedef std::function<bool(std::string&)> read_fn;
+
+    // cached answers younger than this aren't refreshed
+    static const int REVALIDATE_AFTER_SEC = 5;
+
+    StatusCache(const std::string& key);
+
+    // Command line of the process that refreshes a stale answer by calling
+    // refresh() (e.g., asyd with a hidden subcommand); it's started detached
+    // and outlives us. Without one, stale answers are only refreshed by the
+    // next live read.
+    void set_refresher(const std::vector<std::string>& argv);
+
+    // Writes the cached output into [output] and its age into [age_sec],
+    // refreshing it in the background if it's stale. Reads it live with
+    // [live_read] (and caches it) if there is none yet or [fresh] is set,
+    // [age_sec] is 0 then.
+    // Returns false if there was nothing cached and the live read failed.
+    bool read(const read_fn& live_read, bool fresh, std::string& output, long& age_sec);
+
+    // Reads the output live with [live_read] and caches it, unless the
+    // cache was invalidated since the read started. Returns false if
+    // another process is refreshing the same key or the read failed.
+    bool refresh(const read_fn& live_read) const;
+
+    // Drops the cached output, e.g., after an action changed what it shows.
+    // A refresh that started before doesn't store its output anymore.
+    void invalidate() const;
+
+private:
+    std::string key;
+    std::vector<std::string> refresher;
+
+    std::string cache_path() const;
+
+    bool load(std::string& output, std::time_t& observed_at) const;
+    bool store(const std::string& output) const;
+
+    // starts the refresher unless another process is already refreshing
+    // the same key
+    void revalidate_in_background() const;
+}; // class StatusCache
+}; // namespace asyd
@@ -3,6 +3,8 @@
 #include <cstdio>
 #include <fstream>
 #include <unordered_map>
+#include <map>
+#include <vector>
 #include <string>
 
 #include "util.hpp"
@@ -17,17 +19,40 @@ class Systemd
 public:
     typedef void (Systemd::*key_action_fptr)(const std::string&);
 
+    // Supported resource-control/CPU-placement settings as pairs of
+    // config key and the [Service] directive they are written to.
+    static const std::vector<std::pair<std::string, std::string>> RESOURCE_CONTROLS;
+
     Systemd()
     {
         this->key_action["Description"] = &Systemd::set_description;
         this->key_action["WorkingDirectory"] = &Systemd::set_working_directory;
         this->key_action["ExecStart"] = &Systemd::set_entry_point;
+        this->key_action["OnCalendar"] = &Systemd::set_schedule;
+        this->key_action["RandomizedDelaySec"] = &Systemd::set_randomized_delay_sec;
+        this->key_action["AccuracySec"] = &Systemd::set_accuracy_sec;
+        this->key_action["Persistent"] = &Systemd::set_persistent;
+        this->key_action["ListenStream"] = &Systemd::set_listen_stream;
+        this->key_action["Environment"] = &Systemd::set_environment;
+        this->key_action["Type"] = &Systemd::set_type;
+        this->key_action["TimeoutStartSec"] = &Systemd::set_timeout_start_sec;
+        this->key_action["ExecReload"] = &Systemd::set_exec_reload;
     }
 
+    // Returns the [Service] directive for a resource-control config key
+    // or an empty string if the key is not a resource control.
+    static std::string resource_control_directive(const std::string& config_key);
+
     // Build Systemd object from Config object.
     // Returns true on success, false otherwise.
     void from_config(const asyd::Config& config);
 
+    // Writes the settings the systemd file(s) carry into [config] (the
+    // reverse of from_config()), e.g., to rebuild a project's config from
+    // the units on its server. Settings that only exist locally (e.g., the
+    // working directory) are left as they are.
+    void to_config(asyd::Config& config) const;
+
     // Build Systemd object from file.
     // Returns true on success, false otherwise.
     bool from_file(const std::string& filepath);
@@ -36,6 +61,24 @@ public:
     // Returns true on success, false otherwise.
     bool to_file(const std::string& filepath);
 
+    // Write the .timer of a job to file.
+    // Returns true on success, false otherwise.
+    bool to_timer_file(const std::string& filepath);
+
+    // Write the .socket of a socket-activated server to file.
+    // Returns true on success, false otherwise.
+    bool to_socket_file(const std::string& filepath);
+
+    bool is_job() const
+    {
+        return this->schedule.length() > 0;
+    }
+
+    bool is_socket_activated() const
+    {
+        return !this->is_job() && this->listen_stream.length() > 0;
+    }
+
     void set_description(const std::string& description)
     {
         this->description = asyd::util::strip_newline(description);
@@ -51,11 +94,84 @@ public:
         this->entry_point = asyd::util::strip_newline(entry_point);
     }
 
+    void set_schedule(const std::string& schedule)
+    {
+        this->schedule = asyd::util::strip_newline(schedule);
+    }
+
+    void set_randomized_delay_sec(const std::string& randomized_delay_sec)
+    {
+        this->randomized_delay_sec = asyd::util::strip_newline(randomized_delay_sec);
+    }
+
+    void set_accuracy_sec(const std::string& accuracy_sec)
+    {
+        this->accuracy_sec = asyd::util::strip_newline(accuracy_sec);
+    }
+
+    void set_persistent(const std::string& persistent)
+    {
+        this->persistent = asyd::util::strip_newline(persistent);
+    }
+
+    void set_listen_stream(const std::string& listen_stream)
+    {
+        this->listen_stream = asyd::util::strip_newline(listen_stream);
+    }
+
+    // only Type=notify is kept (as the readiness check), the
+    // other types follow from the kind of project
+    void set_type(const std::string& type)
+    {
+        if (asyd::util::strip_newline(type) == "notify")
+            this->readiness = "notify";
+    }
+
+    void set_timeout_start_sec(const std::string& timeout_start_sec)
+    {
+        this->readiness_timeout_sec = asyd::util::strip_newline(timeout_start_sec);
+    }
+
+    // parses the signal out of ExecReload=/bin/kill -s SIGNAL $MAINPID
+    void set_exec_reload(const std::string& exec_reload);
+
+    // parses the asyd variables out of an Environment= line
+    void set_environment(const std::string& environment);
+
+    // directive -> value of the resource controls in the [Service] section
+    const std::map<std::string, std::string>& get_resource_controls() const
+    {
+        return this->resource_controls;
+    }
+
 private:
     bool is_sudo;
+    std::string project_name;
     std::string description;
     std::string working_directory;
     std::string entry_point;
+    std::map<std::string, std::string> resource_controls;
+
+    // [Timer] settings of jobs
+    std::string schedule;
+    std::string randomized_delay_sec;
+    std::string accuracy_sec;
+    std::string persistent;
+
+    // [Socket] settings of socket-activated servers
+    std::string listen_stream;
+    std::string idle_timeout_sec;
+
+    // readiness check of servers
+    std::string readiness;
+    std::string readiness_timeout_sec;
+
+    // signal sent to the service to reload it
+    std::string reload_signal;
+
+    // template unit of a server with several instances
+    bool is_templated = false;
+    std::string base_port;
 
     std::unordered_map<std::string, key_action_fptr> key_action;
 }; // class Systemd
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <utility>
 #include <string>
+#include <vector>
 
 namespace asyd
 {
@@ -10,5 +12,38 @@ namespace util
     std::pair<std::string, std::string> parse_line(const std::string& current_line);
 
     std::string strip_newline(const std::string& value);
+
+    // [value] in single quotes for a shell, e.g., a command run over ssh
+    std::string shell_quote(const std::string& value);
+
+    // splits [value] at [separator], skipping empty tokens and
+    // surrounding spaces (e.g., for comma-separated config values)
+    std::vector<std::string> split(const std::string& value, char separator);
+
+    // [value] as a number if it's a positive integer (digits only),
+    // 0 otherwise
+    int parse_positive_int(const std::string& value);
+
+    // [value] as a number if it's a positive decimal number (e.g., "0.8"),
+    // 0 otherwise
+    double parse_positive_double(const std::string& value);
+
+    // a counter reported by systemd, -1 for values it doesn't track
+    // ("[not set]" or UINT64_MAX)
+    int64_t parse_counter(const std::string& value);
+
+    // Orders the nodes 0..n-1 of a graph where node i depends on the nodes
+    // in [dependencies][i] so that every node comes after its dependencies.
+    // Nodes on a cycle (or depending on one) can't be ordered and are left
+    // out of [order]; returns false if there are any.
+    bool order_dependencies(const std::vector<std::vector<size_t>>& dependencies, std::vector<size_t>& order);
+
+    std::string get_home_dir();
+
+    // local directory with all asyd projects (~/.asyd/)
+    std::string get_asyd_dir();
+
+    // local directory of a project (~/.asyd/project_name/)
+    std::string get_asyd_project_dir(const std::string& project_name);
 }; // namespace util
 }; // namespace asyd
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <unordered_map>
+
+namespace asyd
+{
+class Watcher
+{
+public:
+    Watcher(const std::string& root_directory);
+    ~Watcher();
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    // Starts watching the root directory and all of its subdirectories.
+    // Returns false if inotify could not be set up.
+    bool start();
+
+    // Blocks until files change and the burst of changes has settled, i.e.,
+    // no new events arrived for [debounce_ms].
+    // Writes the changed paths (relative to the root directory) into
+    // [changed_paths] and the time of the first event into [first_change].
+    bool wait_for_changes(
+        std::vector<std::string>& changed_paths,
+        std::chrono::steady_clock::time_point& first_change,
+        int debounce_ms = 250);
+
+    // true if the kernel's event queue overflowed during the last
+    // wait_for_changes(), so changes may have been missed and the whole
+    // tree has to be synced ([changed_paths] then has every file)
+    bool missed_changes() const
+    {
+        return this->overflowed;
+    }
+
+private:
+    std::string root_directory;
+    int inotify_fd = -1;
+    bool overflowed = false;
+
+    // watch descriptor -> directory relative to the root ("" for the root)
+    std::unordered_map<int, std::string> watch_directories;
+
+    bool add_watch(const std::string& relative_directory);
+    bool add_watch_recursive(const std::string& relative_directory);
+
+    // reads all pending events and records the changed paths
+    bool read_events(std::set<std::string>& changed_paths);
+
+    // records every file below a newly created directory since its
+    // contents may have been written before the watch was added
+    void add_directory_contents(
+        const std::string& relative_directory,
+        std::set<std::string>& changed_paths) const;
+}; // class Watcher
+}; // namespace asyd
@@ -1,12 +1,319 @@
 #include "cli.hpp"
 #include "argparse.hpp"
-#include "server.hpp"
+#include "bandwidth.hpp"
+#include "libasyd.hpp"
+#include "systemd.hpp"
+#include "util.hpp"
+
+#include <map>
 
 using namespace asyd;
 
+// prints transfers that have to wait for the bandwidth limits
+// and when they start (see BandwidthScheduler)
+static void report_transfer(
+    BandwidthScheduler::Event event,
+    const BandwidthScheduler::Transfer& transfer,
+    const std::vector<BandwidthScheduler::Transfer>& transfers)
+{
+    size_t active = 0;
+    for (const BandwidthScheduler::Transfer& other : transfers)
+        active += other.active;
+
+    bool waited = std::chrono::steady_clock::now() - transfer.queued_at > std::chrono::milliseconds(100);
+
+    if (event == BandwidthScheduler::Event::QUEUED && active > 0)
+        std::cerr << "   ~   QUEUED " << transfer.description;
+    else if (event == BandwidthScheduler::Event::STARTED && waited)
+        std::cerr << "   ~   STARTED " << transfer.description;
+    else
+        return;
+
+    if (transfer.bandwidth_limit > 0)
+        std::cerr << " AT " << transfer.bandwidth_limit << " KB/S";
+    std::cerr << " (" << active << " ACTIVE, " << transfers.size() - active << " QUEUED)\n";
+}
+
+// start/stop/restart/deploy of a single project
+static int run_project_action(
+    const std::string& action,
+    const std::string& project_name,
+    const std::string& transfer_priority = "")
+{
+    Project project;
+    Result result = project.load(project_name);
+
+    if (result.ok() && transfer_priority.length() > 0)
+        project.set_setting("transfer_priority", transfer_priority);
+
+    if (result.ok())
+    {
+        if (action == "start")
+            result = project.start();
+        else if (action == "stop")
+            result = project.stop();
+        else if (action == "restart")
+            result = project.restart();
+        else if (action == "deploy")
+            result = project.deploy();
+        else if (action == "stage")
+            result = project.stage();
+        else if (action == "activate")
+            result = project.activate();
+    }
+
+    for (const TargetResult& target_result : result.target_results)
+    {
+        if (target_result.success)
+            std::cout << "   *   " << target_result.hostname << ": OK (READY AFTER "
+                << target_result.time_to_ready.count() << " MS)\n";
+        else
+            std::cout << "   *   " << target_result.hostname << ": FAILED (" << target_result.message << ")\n";
+    }
+
+    if (!result.ok())
+    {
+        std::cerr << "Couldn't " << action << " '" << project_name << "': " << result.message << ".\n";
+        return -1;
+    }
+
+    std::string action_copy = action == "stop" ? "stopped" : action.back() == 'e' ? action + "d" : action + "ed";
+    std::transform(action_copy.begin(), action_copy.end(), action_copy.begin(), ::toupper);
+
+    bool is_deploy = action == "deploy" || action == "stage" || action == "activate";
+    if (is_deploy)
+        std::cout << "SUCCESSFULLY " << action_copy << " PROJECT '" << project_name << "'";
+    else
+        std::cout << "SUCCESSFULLY " << action_copy << " SERVICE '" << project_name << "'";
+
+    if (result.build_outcome == BuildOutcome::UP_TO_DATE || result.build_outcome == BuildOutcome::RESTORED)
+        std::cout << " (BUILD CACHED)";
+
+    if (action == "stage")
+    {
+        std::string staged = result.output;
+        std::transform(staged.begin(), staged.end(), staged.begin(), ::toupper);
+        std::cout << " (" << staged << ")";
+    }
+    else if (is_deploy && result.change_action == ChangeAction::NONE)
+        std::cout << " (NO RESTART NEEDED)";
+    else if (is_deploy && result.change_action == ChangeAction::RELOAD)
+        std::cout << " (RELOADED)";
+    else if (action != "stop" && !project.is_job())
+        std::cout << " (READY AFTER " << result.time_to_ready.count() << " MS)";
+    std::cout << ".\n";
+
+    return 0;
+}
+
+// start/stop/restart of several projects and/or globs, e.g., "api-*"
+static int run_bulk_action(const std::string& action, const std::vector<std::string>& patterns)
+{
+    Result result = asyd::service_action(patterns, action);
+
+    for (const TargetResult& target_result : result.target_results)
+    {
+        std::cout << "   *   " << target_result.project_name;
+        if (target_result.hostname.length() > 0)
+            std::cout << " (" << target_result.hostname << ")";
+        std::cout << ": " << (target_result.success ? "OK" : "FAILED") << " (" << target_result.message << ")\n";
+    }
+
+    if (!result.ok())
+    {
+        std::cerr << "Couldn't " << action << " all services: " << result.message << ".\n";
+        return -1;
+    }
+
+    std::cout << "SUCCESSFULLY RAN '" << action << "' ON " << result.target_results.size()
+        << " SERVICE(S) IN " << result.duration.count() << " MS.\n";
+    return 0;
+}
+
+// deploy of several projects and/or globs, ordered by their depends_on
+static int run_group_deploy(const std::vector<std::string>& patterns)
+{
+    Result result = asyd::deploy_projects(patterns);
+
+    for (const TargetResult& target_result : result.target_results)
+    {
+        std::cout << "   *   " << target_result.project_name << " (" << target_result.hostname << "): "
+            << (target_result.success ? "OK" : "FAILED") << " (" << target_result.message << ")\n";
+    }
+
+    if (!result.ok())
+    {
+        std::cerr << "Couldn't deploy all projects: " << result.message << ".\n";
+        return -1;
+    }
+
+    std::cout << "SUCCESSFULLY DEPLOYED " << result.target_results.size()
+        << " PROJECT(S) IN " << result.duration.count() << " MS.\n";
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     CLI cli;
+    BandwidthScheduler::get().set_observer(report_transfer);
+
+    /* CACHE REFRESH, started by StatusCache: asyd __refresh status|ls <project/host> */
+    if (argc == 4 && std::string(argv[1]) == "__refresh")
+        return cli.refresh_cached(std::string(argv[2]), std::string(argv[3])) ? 0 : -1;
+
+    /* LIVE RESOURCE VIEW: asyd top [--interval N] [--sort KEY] [projects/globs...] */
+    if (argc >= 2 && std::string(argv[1]) == "top")
+    {
+        int interval_sec = 2;
+        std::string sort_key = "cpu";
+        std::vector<std::string> patterns;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = std::string(argv[i]);
+            if (arg == "--interval" && i + 1 < argc)
+                interval_sec = std::max(std::atoi(argv[++i]), 1);
+            else if (arg == "--sort" && i + 1 < argc)
+                sort_key = std::string(argv[++i]);
+            else
+                patterns.push_back(arg);
+        }
+
+        if (sort_key != "cpu" && sort_key != "memory" && sort_key != "io"
+            && sort_key != "tasks" && sort_key != "restarts" && sort_key != "name")
+        {
+            std::cerr << "Invalid sort key '" << sort_key << "' - must be one of cpu, memory, io, tasks, restarts or name.\n";
+            return -1;
+        }
+
+        return cli.top(patterns, interval_sec, sort_key) ? 0 : -1;
+    }
+
+    /* MERGED LOG STREAM: asyd logs [-n N] [--no-follow] [--window MS] <projects/hosts/globs...> */
+    if (argc >= 3 && std::string(argv[1]) == "logs")
+    {
+        int lines = 10;
+        bool follow = true;
+        int reorder_window_ms = 500;
+        std::vector<std::string> patterns;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = std::string(argv[i]);
+            if (arg == "-n" && i + 1 < argc)
+                lines = std::max(std::atoi(argv[++i]), 0);
+            else if (arg == "--no-follow")
+                follow = false;
+            else if (arg == "--window" && i + 1 < argc)
+                reorder_window_ms = std::max(std::atoi(argv[++i]), 0);
+            else
+                patterns.push_back(arg);
+        }
+
+        if (patterns.empty())
+        {
+            std::cerr << "No projects or hosts given.\n";
+            return -1;
+        }
+
+        return cli.logs(patterns, lines, follow, reorder_window_ms) ? 0 : -1;
+    }
+
+    /* JOB RUN HISTORY: asyd runs [-n N] <job> */
+    if (argc >= 3 && std::string(argv[1]) == "runs")
+    {
+        size_t max_runs = 20;
+        std::string project_name;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = std::string(argv[i]);
+            if (arg == "-n" && i + 1 < argc)
+                max_runs = std::max(std::atoi(argv[++i]), 1);
+            else
+                project_name = arg;
+        }
+
+        if (project_name.empty())
+        {
+            std::cerr << "No job given.\n";
+            return -1;
+        }
+
+        return cli.runs(project_name, max_runs) ? 0 : -1;
+    }
+
+    /* AD-HOC COMMAND ON ALL HOSTS: asyd exec [-j N] [--timeout SEC] <projects/globs...> -- <command...> */
+    if (argc >= 3 && std::string(argv[1]) == "exec")
+    {
+        size_t max_parallel = 10;
+        int timeout_sec = 60;
+        std::vector<std::string> patterns;
+        std::string command;
+
+        int i = 2;
+        for (; i < argc && std::string(argv[i]) != "--"; ++i)
+        {
+            std::string arg = std::string(argv[i]);
+            if (arg == "-j" && i + 1 < argc)
+                max_parallel = std::max(std::atoi(argv[++i]), 1);
+            else if (arg == "--timeout" && i + 1 < argc)
+                timeout_sec = std::max(std::atoi(argv[++i]), 0);
+            else
+                patterns.push_back(arg);
+        }
+
+        // everything after "--" is the command, as the server's shell sees it
+        for (++i; i < argc; ++i)
+            command += (command.empty() ? "" : " ") + std::string(argv[i]);
+
+        if (patterns.empty() || command.empty())
+        {
+            std::cerr << "Usage: asyd exec [-j N] [--timeout SEC] <projects...> -- <command>\n";
+            return -1;
+        }
+
+        return cli.exec(patterns, command, max_parallel, timeout_sec) ? 0 : -1;
+    }
+
+    /* PULL PROJECTS FROM SERVERS: asyd pull [--only project/glob]... <hosts...> */
+    if (argc >= 3 && std::string(argv[1]) == "pull")
+    {
+        std::vector<std::string> hostnames;
+        std::vector<std::string> patterns;
+
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = std::string(argv[i]);
+            if (arg == "--only" && i + 1 < argc)
+                patterns.push_back(std::string(argv[++i]));
+            else
+                hostnames.push_back(arg);
+        }
+
+        if (hostnames.empty())
+        {
+            std::cerr << "No servers given.\n";
+            return -1;
+        }
+
+        return cli.pull(hostnames, patterns) ? 0 : -1;
+    }
+
+    /* BULK SERVICE ACTIONS */
+    if (argc >= 3)
+    {
+        std::string action = std::string(argv[1]);
+        bool is_service_action = action == "start" || action == "stop" || action == "restart";
+        bool is_glob = std::string(argv[2]).find_first_of("*?[") != std::string::npos;
+
+        if (is_service_action && (argc > 3 || is_glob))
+            return run_bulk_action(action, std::vector<std::string>(argv + 2, argv + argc));
+
+        // deploy options (e.g., --plan) start with dashes
+        if (action == "deploy" && std::string(argv[2]).rfind("--", 0) != 0 && (argc > 3 || is_glob))
+            return run_group_deploy(std::vector<std::string>(argv + 2, argv + argc));
+    }
 
     /* FOUR ARGUMENT COMMANDS */
     if (argc == 4)
@@ -29,6 +336,51 @@ int main(int argc, char** argv)
                 return -1;
             }
         }
+        else if ((action == "status" || action == "ls") && std::string(argv[2]) == "--fresh")
+        {
+            // skips the cache (and updates it)
+            if (action == "status")
+                return cli.status(std::string(argv[3]), true) ? 0 : -1;
+            return cli.list_services(std::string(argv[3]), true) ? 0 : -1;
+        }
+        else if (action == "deploy" && std::string(argv[2]) == "--plan")
+        {
+            std::string project_name = std::string(argv[3]);
+
+            Project project;
+            Result result = project.load(project_name);
+            if (result.ok())
+                result = project.plan();
+
+            if (!result.ok())
+            {
+                std::cerr << "Couldn't plan deploy of '" << project_name << "': " << result.message << ".\n";
+                return -1;
+            }
+
+            if (result.output.empty())
+                std::cout << "NOTHING TO DO, PROJECT '" << project_name << "' IS UP TO DATE.\n";
+            else
+            {
+                std::cout << "DEPLOYING PROJECT '" << project_name << "' WOULD:\n";
+                for (const std::string& step : asyd::util::split(result.output, '\n'))
+                    std::cout << "   *   " << step << "\n";
+            }
+        }
+        else if (action == "deploy" && std::string(argv[2]) == "--urgent")
+        {
+            // e.g., a hotfix: its transfers go ahead of the queued ones
+            return run_project_action(action, std::string(argv[3]), "urgent");
+        }
+        else if (action == "deploy" && std::string(argv[2]) == "--watch")
+        {
+            std::string project_name = std::string(argv[3]);
+            if (!cli.watch_project(project_name))
+            {
+                std::cerr << "Stopped watching project '" << project_name << "'.\n";
+                return -1;
+            }
+        }
         else
         {
             std::cerr << "Unknown command.\n";
@@ -56,54 +408,39 @@ int main(int argc, char** argv)
                 return -1;
             }
         }
-        else if (action == "start")
+        else if (action == "start" || action == "stop" || action == "restart"
+            || action == "deploy" || action == "stage" || action == "activate")
         {
-            if (!cli.start_service(project_name))
-            {
-                std::cerr << "Couldn't start service '" << project_name << "'.\n";
-                return -1;
-            }
+            return run_project_action(action, project_name);
         }
-        else if (action == "stop")
+        else if (action == "status")
         {
-            if (!cli.stop_service(project_name))
-            {
-                std::cerr << "Couldn't stop service '" << project_name << "'.\n";
-                return -1;
-            }
+            return cli.status(project_name, false) ? 0 : -1;
         }
-        else if (action == "restart")
+        else if (action == "apply")
         {
-            if (!cli.restart_service(project_name))
-            {
-                std::cerr << "Couldn't restart service '" << project_name << "'.\n";
-                return -1;
-            }
+            return cli.apply(std::string(argv[2])) ? 0 : -1;
         }
-        else if (action == "status")
+        else if (action == "scan")
         {
-            std::string status;
-            if (!cli.check_status(project_name, status))
+            if (!cli.scan_project(project_name))
             {
-                std::cerr << "Couldn't check status for service '" << project_name << "'.\n";
+                std::cerr << "Couldn't scan project '" << project_name << "'.\n";
                 return -1;
             }
-
-            std::cout << status << "\n";
         }
-        else if (action == "ls")
+        else if (action == "link")
         {
             std::string hostname = std::string(argv[2]);
-            Server server(hostname);
-
-            std::string output;
-            if (!server.list_services(output))
+            if (!cli.measure_link(hostname))
             {
-                std::cerr << "Couldn't list services.\n";
+                std::cerr << "Couldn't measure the link to '" << hostname << "'.\n";
                 return -1;
             }
-
-            std::cout << output << "\n";
+        }
+        else if (action == "ls")
+        {
+            return cli.list_services(std::string(argv[2]), false) ? 0 : -1;
         }
         else
         {
@@ -115,7 +452,130 @@ int main(int argc, char** argv)
     /* OPTIONAL POSITION ARGUMENT COMMANDS */
     else
     {
-        argparse::ArgumentParser program("asyd");
+        // -h is used for the hostname, so the default help arguments are disabled
+        argparse::ArgumentParser program("asyd", "1.0", argparse::default_arguments::none);
+
+        program.add_argument("-P", "--project")
+            .required()
+            .help("name of the project to configure");
+
+        // resource controls are set with --<config-key> where underscores
+        // are replaced by dashes, e.g., --memory-max 2G
+        std::map<std::string, std::string> setting_flags;
+        for (const auto& [key, directive] : Systemd::RESOURCE_CONTROLS)
+        {
+            std::string flag = "--" + key;
+            std::replace(flag.begin(), flag.end(), '_', '-');
+            setting_flags[flag] = key;
+
+            program.add_argument(flag)
+                .help("set " + directive + "= of the systemd service (empty string to remove)");
+        }
+
+        setting_flags["--randomized-delay-sec"] = "randomized_delay_sec";
+        program.add_argument("--randomized-delay-sec")
+            .help("jobs: maximum random delay of each run, fixed per server to spread out jobs");
+
+        setting_flags["--accuracy-sec"] = "accuracy_sec";
+        program.add_argument("--accuracy-sec")
+            .help("jobs: accuracy of the timer");
+
+        setting_flags["--persistent"] = "persistent";
+        program.add_argument("--persistent")
+            .help("jobs: 'true' to catch up on runs missed while the server was down");
+
+        setting_flags["--overrun-fraction"] = "overrun_fraction";
+        program.add_argument("--overrun-fraction")
+            .help("jobs: fraction of the schedule interval after which 'asyd runs' flags a run (default 0.8)");
+
+        setting_flags["--listen-stream"] = "listen_stream";
+        program.add_argument("--listen-stream")
+            .help("servers: port/address of a socket that starts the service on the first connection");
+
+        setting_flags["--readiness"] = "readiness";
+        program.add_argument("--readiness")
+            .help("servers: wait for 'notify', 'tcp:[host:]port' or an http(s):// health URL after (re)starting");
+
+        setting_flags["--readiness-timeout-sec"] = "readiness_timeout_sec";
+        program.add_argument("--readiness-timeout-sec")
+            .help("servers: how long to wait for the service to get ready (DEFAULT: 30)");
+
+        setting_flags["--relay-hostname"] = "relay_hostname";
+        program.add_argument("--relay-hostname")
+            .help("deploy through this relay host (e.g., a bastion) which distributes to all targets");
+
+        setting_flags["--relay-targets"] = "relay_targets";
+        program.add_argument("--relay-targets")
+            .help("comma-separated hosts to deploy to through the relay besides the project's host");
+
+        setting_flags["--relay-fanout"] = "relay_fanout";
+        program.add_argument("--relay-fanout")
+            .help("distribute as a tree where each host forwards to this many targets (DEFAULT: 0, the relay sends to all)");
+
+        setting_flags["--restart-paths"] = "restart_paths";
+        program.add_argument("--restart-paths")
+            .help("comma-separated globs of files that always need a restart when deployed");
+
+        setting_flags["--reload-paths"] = "reload_paths";
+        program.add_argument("--reload-paths")
+            .help("comma-separated globs of files that only need a reload when deployed");
+
+        setting_flags["--ignore-paths"] = "ignore_paths";
+        program.add_argument("--ignore-paths")
+            .help("comma-separated globs of files that need neither a restart nor a reload when deployed");
+
+        setting_flags["--reload-signal"] = "reload_signal";
+        program.add_argument("--reload-signal")
+            .help("signal that makes the service reload (e.g., HUP), required for reload-only deploys");
+
+        setting_flags["--idle-timeout-sec"] = "idle_timeout_sec";
+        program.add_argument("--idle-timeout-sec")
+            .help("servers: passed as ASYD_IDLE_TIMEOUT_SEC to socket-activated services that exit when idle");
+
+        setting_flags["--instances"] = "instances";
+        program.add_argument("--instances")
+            .help("servers: number of instances to run from a template unit, e.g., one per core (DEFAULT: 1)");
+
+        setting_flags["--base-port"] = "base_port";
+        program.add_argument("--base-port")
+            .help("servers: port of instance 0, instance i gets ASYD_PORT = base port + i");
+
+        setting_flags["--pin-instances"] = "pin_instances";
+        program.add_argument("--pin-instances")
+            .help("servers: 'true' to pin instance i to CPU i (modulo the number of CPUs)");
+
+        setting_flags["--compression"] = "compression";
+        program.add_argument("--compression")
+            .help("rsync compression level (1-9) or 'none' (DEFAULT: chosen by the measured link)");
+
+        setting_flags["--cipher"] = "cipher";
+        program.add_argument("--cipher")
+            .help("ssh cipher(s) to transfer with (DEFAULT: chosen by the measured link)");
+
+        setting_flags["--transfer-streams"] = "transfer_streams";
+        program.add_argument("--transfer-streams")
+            .help("number of parallel rsync streams (DEFAULT: chosen by the measured link)");
+
+        setting_flags["--transfer-priority"] = "transfer_priority";
+        program.add_argument("--transfer-priority")
+            .help("'urgent', 'normal' or 'bulk': order of the project's transfers under the bandwidth limits (DEFAULT: normal)");
+
+        setting_flags["--build-command"] = "build_command";
+        program.add_argument("--build-command")
+            .help("shell command that builds the project locally before deploys (skipped if the inputs didn't change)");
+
+        setting_flags["--build-inputs"] = "build_inputs";
+        program.add_argument("--build-inputs")
+            .help("comma-separated globs of the files the build reads (DEFAULT: all but the output)");
+
+        setting_flags["--build-output"] = "build_output";
+        program.add_argument("--build-output")
+            .help("file or directory the build writes, relative to the working directory");
+
+        setting_flags["--depends-on"] = "depends_on";
+        program.add_argument("--depends-on")
+            .help("comma-separated projects that are restarted before this one when deployed together");
+
         try
         {
             program.parse_args(argc, argv);
@@ -123,12 +583,26 @@ int main(int argc, char** argv)
         catch (const std::exception& ex)
         {
             std::cerr << ex.what() << "\n";
+            std::cerr << program;
             return -1;
         }
 
-        if (program["action"] == true)
+        std::map<std::string, std::string> settings;
+        for (const auto& [flag, key] : setting_flags)
+            if (auto value = program.present<std::string>(flag))
+                settings[key] = *value;
+
+        std::string project_name = program.get<std::string>("--project");
+        if (settings.empty())
+        {
+            std::cerr << "No settings given for project '" << project_name << "'.\n";
+            return -1;
+        }
+
+        if (!cli.configure_project(project_name, settings))
         {
-            std::cout << program.get<std::string>("action") << "\n";
+            std::cerr << "Couldn't update project '" << project_name << "'.\n";
+            return -1;
         }
     }
 
@@ -0,0 +1,246 @@
+#include "bandwidth.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <tuple>
+
+using namespace asyd;
+
+BandwidthScheduler::Ticket::Ticket(BandwidthScheduler* scheduler, uint64_t id, int64_t bandwidth_limit)
+{
+    this->scheduler = scheduler;
+    this->id = id;
+    this->bandwidth_limit = bandwidth_limit;
+}
+
+BandwidthScheduler::Ticket::Ticket(Ticket&& other)
+{
+    this->scheduler = other.scheduler;
+    this->id = other.id;
+    this->bandwidth_limit = other.bandwidth_limit;
+    other.scheduler = nullptr;
+}
+
+BandwidthScheduler::Ticket::~Ticket()
+{
+    if (this->scheduler != nullptr)
+        this->scheduler->release(this->id);
+}
+
+BandwidthScheduler& BandwidthScheduler::get()
+{
+    static BandwidthScheduler scheduler;
+    static std::once_flag limits_loaded;
+
+    std::call_once(limits_loaded, []() {
+        scheduler.load_limits(asyd::util::get_asyd_dir() + ".transfers");
+    });
+
+    return scheduler;
+}
+
+void BandwidthScheduler::set_limits(const Limits& limits)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->limits = limits;
+    this->transfers_changed.notify_all();
+}
+
+BandwidthScheduler::Limits BandwidthScheduler::get_limits() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->limits;
+}
+
+bool BandwidthScheduler::load_limits(const std::string& filepath)
+{
+    std::ifstream file(filepath);
+    if (!file.is_open())
+        return false;
+
+    Limits limits;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        auto [key, value] = asyd::util::parse_line(line);
+        if (key == "bandwidth_limit")
+            limits.bandwidth_limit = std::atoll(value.c_str());
+        else if (key == "host_bandwidth_limit")
+            limits.host_bandwidth_limit = std::atoll(value.c_str());
+        else if (key == "max_transfers")
+            limits.max_transfers = std::atoll(value.c_str());
+    }
+
+    this->set_limits(limits);
+    return true;
+}
+
+BandwidthScheduler::Ticket BandwidthScheduler::acquire(
+    const std::string& hostname,
+    const std::string& description,
+    uint64_t bytes,
+    Priority priority)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    Transfer transfer;
+    transfer.id = this->next_id++;
+    transfer.hostname = hostname;
+    transfer.description = description;
+    transfer.bytes = bytes;
+    transfer.priority = priority;
+    transfer.queued_at = std::chrono::steady_clock::now();
+    this->transfers.push_back(transfer);
+
+    this->notify(Event::QUEUED, transfer, lock);
+
+    this->transfers_changed.wait(lock, [&]() {
+        const Transfer* next = this->next_transfer();
+        return next != nullptr && next->id == transfer.id;
+    });
+
+    auto started = std::find_if(this->transfers.begin(), this->transfers.end(),
+        [&](const Transfer& queued) { return queued.id == transfer.id; });
+
+    this->share_for(*started, started->bandwidth_limit);
+    started->active = true;
+    started->started_at = std::chrono::steady_clock::now();
+    transfer = *started;
+
+    // the next transfer may be able to start as well
+    this->transfers_changed.notify_all();
+    this->notify(Event::STARTED, transfer, lock);
+
+    return Ticket(this, transfer.id, transfer.bandwidth_limit);
+}
+
+void BandwidthScheduler::release(uint64_t id)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    auto finished = std::find_if(this->transfers.begin(), this->transfers.end(),
+        [&](const Transfer& transfer) { return transfer.id == id; });
+    if (finished == this->transfers.end())
+        return;
+
+    Transfer transfer = *finished;
+    this->transfers.erase(finished);
+
+    this->transfers_changed.notify_all();
+    this->notify(Event::FINISHED, transfer, lock);
+}
+
+bool BandwidthScheduler::share_for(const Transfer& transfer, int64_t& bandwidth_limit) const
+{
+    size_t active = 0;
+    size_t queued = 0;
+    size_t host_active = 0;
+    size_t host_queued = 0;
+    int64_t used = 0;
+    int64_t host_used = 0;
+
+    for (const Transfer& other : this->transfers)
+    {
+        bool same_host = other.hostname == transfer.hostname;
+        if (other.active)
+        {
+            active++;
+            used += other.bandwidth_limit;
+            host_active += same_host;
+            host_used += same_host ? other.bandwidth_limit : 0;
+        }
+        else
+        {
+            queued++;
+            host_queued += same_host;
+        }
+    }
+
+    if (this->limits.max_transfers > 0 && active >= this->limits.max_transfers)
+        return false;
+
+    bandwidth_limit = 0;
+
+    // a limit is split into as many slots as transfers may run at once;
+    // a transfer needs at least half a slot of free budget and gets its
+    // fair share of what's left among the transfers competing for it. All
+    // but urgent transfers leave one slot free so an urgent one can always start.
+    auto share = [&](int64_t limit, int64_t limit_used, size_t competing) {
+        if (limit <= 0)
+            return true;
+
+        size_t slots = this->limits.max_transfers > 0 ? this->limits.max_transfers : std::max<size_t>(competing, 1);
+        competing = std::clamp<size_t>(competing, 1, slots);
+
+        int64_t slot = std::max<int64_t>(limit / slots, 1);
+        int64_t reserved = transfer.priority != Priority::URGENT && slots > 1 ? slot : 0;
+        int64_t available = limit - limit_used - reserved;
+        if (available < std::max<int64_t>(slot / 2, 1))
+            return false;
+
+        int64_t transfer_share = std::min(available, std::max(limit / static_cast<int64_t>(competing), slot));
+        if (transfer.priority == Priority::BULK)
+            transfer_share = std::min(transfer_share, std::max<int64_t>(limit / 2, 1));
+
+        bandwidth_limit = bandwidth_limit == 0 ? transfer_share : std::min(bandwidth_limit, transfer_share);
+        return true;
+    };
+
+    return share(this->limits.bandwidth_limit, used, active + queued)
+        && share(this->limits.host_bandwidth_limit, host_used, host_active + host_queued);
+}
+
+const BandwidthScheduler::Transfer* BandwidthScheduler::next_transfer() const
+{
+    std::vector<const Transfer*> queued;
+    for (const Transfer& transfer : this->transfers)
+        if (!transfer.active)
+            queued.push_back(&transfer);
+
+    // unknown sizes count as the largest
+    auto rank = [](const Transfer* transfer) {
+        uint64_t bytes = transfer->bytes > 0 ? transfer->bytes : std::numeric_limits<uint64_t>::max();
+        return std::make_tuple(transfer->priority, bytes, transfer->id);
+    };
+
+    std::sort(queued.begin(), queued.end(), [&](const Transfer* a, const Transfer* b) {
+        return rank(a) < rank(b);
+    });
+
+    // a transfer that can't start (e.g., its host is at its limit)
+    // doesn't hold up the others
+    int64_t bandwidth_limit;
+    for (const Transfer* transfer : queued)
+        if (this->share_for(*transfer, bandwidth_limit))
+            return transfer;
+
+    return nullptr;
+}
+
+std::vector<BandwidthScheduler::Transfer> BandwidthScheduler::get_transfers() const
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return std::vector<Transfer>(this->transfers.begin(), this->transfers.end());
+}
+
+void BandwidthScheduler::set_observer(observer_fn observer)
+{
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->observer = observer;
+}
+
+void BandwidthScheduler::notify(Event event, const Transfer& transfer, std::unique_lock<std::mutex>& lock)
+{
+    if (!this->observer)
+        return;
+
+    observer_fn observer = this->observer;
+    std::vector<Transfer> transfers(this->transfers.begin(), this->transfers.end());
+
+    lock.unlock();
+    observer(event, transfer, transfers);
+    lock.lock();
+}
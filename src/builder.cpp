@@ -0,0 +1,182 @@
+#include "builder.hpp"
+#include "command.hpp"
+#include "config.hpp"
+#include "scanner.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <fnmatch.h>
+
+using namespace asyd;
+
+namespace fs = std::filesystem;
+
+// marks which input hash the output in the working directory was built from
+static const char* CURRENT_FILE = "current";
+
+static std::string to_hex(uint64_t value)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(value));
+    return hex;
+}
+
+static void touch(const std::string& path)
+{
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+}
+
+Builder::Builder(const Config& config) : config(config)
+{
+    this->cache_directory = asyd::util::get_asyd_project_dir(config.get_project_name()) + "builds/";
+}
+
+std::string Builder::get_log_path() const
+{
+    return this->cache_directory + "build.log";
+}
+
+bool Builder::is_input(const std::string& path) const
+{
+    // the output is never an input of itself
+    const std::string& output = this->config.get_build_output();
+    if (output.length() > 0 && (path == output || path.rfind(output + "/", 0) == 0))
+        return false;
+
+    std::vector<std::string> globs = asyd::util::split(this->config.get_build_inputs(), ',');
+    if (globs.empty())
+        return true;
+
+    for (const std::string& glob : globs)
+        if (fnmatch(glob.c_str(), path.c_str(), 0) == 0)
+            return true;
+
+    return false;
+}
+
+bool Builder::hash_inputs(uint64_t& hash) const
+{
+    // shares the cache with the deploys' scans, so unchanged inputs
+    // aren't read again
+    Scanner scanner(
+        this->config.get_working_directory(),
+        asyd::util::get_asyd_project_dir(this->config.get_project_name()) + "scan.cache");
+
+    auto is_input = [this](const std::string& path) { return this->is_input(path); };
+    scanner.set_hash_filter(is_input);
+    if (!scanner.scan(true))
+        return false;
+
+    // a different command builds something different from the same inputs
+    hash = scanner.get_tree_hash(is_input);
+    for (const char c : this->config.get_build_command())
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+
+    return true;
+}
+
+bool Builder::run_build_command() const
+{
+    Command command;
+    command.add("cd '" + this->config.get_working_directory() + "' &&")
+        .add("(" + this->config.get_build_command() + ")")
+        .add("> '" + this->get_log_path() + "' 2>&1");
+
+    return command.execute();
+}
+
+void Builder::prune_cache() const
+{
+    std::vector<fs::directory_entry> builds;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(this->cache_directory, error))
+        if (entry.is_directory())
+            builds.push_back(entry);
+
+    if (builds.size() <= Builder::MAX_CACHED_BUILDS)
+        return;
+
+    std::sort(builds.begin(), builds.end(), [](const fs::directory_entry& a, const fs::directory_entry& b) {
+        return a.last_write_time() > b.last_write_time();
+    });
+
+    for (size_t i = Builder::MAX_CACHED_BUILDS; i < builds.size(); ++i)
+        fs::remove_all(builds[i].path(), error);
+}
+
+Builder::Outcome Builder::build()
+{
+    if (this->config.get_build_command().empty())
+        return Outcome::NOT_CONFIGURED;
+
+    std::error_code error;
+    fs::create_directories(this->cache_directory, error);
+
+    uint64_t hash;
+    if (!this->hash_inputs(hash))
+        return Outcome::FAILED;
+
+    std::string key = to_hex(hash);
+    std::string build_directory = this->cache_directory + key;
+    std::string cached_output = build_directory + "/output";
+
+    const std::string& output = this->config.get_build_output();
+    std::string output_path = this->config.get_working_directory() + "/" + output;
+    bool has_output = output.length() > 0;
+
+    std::string current;
+    std::ifstream current_file(this->cache_directory + CURRENT_FILE);
+    std::getline(current_file, current);
+    current_file.close();
+
+    if (current == key && (!has_output || fs::exists(output_path)))
+    {
+        touch(build_directory);
+        return Outcome::UP_TO_DATE;
+    }
+
+    Outcome outcome = Outcome::RESTORED;
+    if (!has_output || !fs::exists(cached_output))
+    {
+        if (!this->run_build_command())
+            return Outcome::FAILED;
+
+        // copied aside and moved in place, so an interrupted copy is
+        // never taken for a cached output
+        if (has_output)
+        {
+            if (!fs::exists(output_path))
+                return Outcome::FAILED;
+
+            fs::remove_all(build_directory + ".tmp", error);
+            fs::create_directories(build_directory + ".tmp", error);
+            fs::copy(output_path, build_directory + ".tmp/output", fs::copy_options::recursive | fs::copy_options::copy_symlinks, error);
+            if (error)
+                return Outcome::FAILED;
+
+            fs::remove_all(build_directory, error);
+            fs::rename(build_directory + ".tmp", build_directory, error);
+        }
+        else
+            fs::create_directories(build_directory, error);
+
+        outcome = Outcome::BUILT;
+    }
+    else
+    {
+        fs::remove_all(output_path, error);
+        fs::copy(cached_output, output_path, fs::copy_options::recursive | fs::copy_options::copy_symlinks, error);
+        if (error)
+            return Outcome::FAILED;
+    }
+
+    std::ofstream(this->cache_directory + CURRENT_FILE) << key << "\n";
+    touch(build_directory);
+    this->prune_cache();
+
+    return outcome;
+}
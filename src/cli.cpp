@@ -1,28 +1,41 @@
 #include "cli.hpp"
+#include "command.hpp"
 #include "config.hpp"
+#include "job_history.hpp"
+#include "libasyd.hpp"
+#include "link.hpp"
+#include "logs.hpp"
+#include "manifest.hpp"
+#include "monitor.hpp"
+#include "scanner.hpp"
 #include "server.hpp"
+#include "status_cache.hpp"
 #include "systemd.hpp"
+#include "watcher.hpp"
 
-using namespace asyd;
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <csignal>
+#include <ctime>
+#include <deque>
+#include <fnmatch.h>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
 
-// there is currently no portable way (that I know of) to do this as of C++17
-std::string CLI::get_home_dir() const
-{
-    #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
-        return std::string(std::getenv("HOMEDRIVE")) + std::string(std::getenv("HOMEPATH"));
-    #else
-        return std::string(std::getenv("HOME"));
-    #endif
-}
+using namespace asyd;
 
-std::string CLI::get_asyd_dir() const
-{
-    return this->get_home_dir() + "/.asyd/";
-}
+static volatile std::sig_atomic_t interrupted = 0;
 
-std::string CLI::get_asyd_project_dir(const std::string& project_name) const
+static void on_interrupt(int)
 {
-    return this->get_asyd_dir() + project_name + "/";
+    interrupted = 1;
 }
 
 void CLI::generate_config(
@@ -71,6 +84,12 @@ void CLI::generate_config(
         std::cout << "\nJob schedule in systemd's OnCalendar format (e.g., Mon,Fri *-*-* 06:00:00): ";
         std::getline(std::cin, entry);
         config.set_schedule(entry);
+
+        std::cout << "\nMaximum random delay to spread out job starts on the server (DEFAULT: 1min): ";
+        std::getline(std::cin, entry);
+        if (entry == "")
+            entry = "1min";
+        config.set_randomized_delay_sec(entry);
     }
 
     Server server(config.get_server_hostname());
@@ -90,10 +109,7 @@ void CLI::generate_config(
         return;
     }
 
-    Systemd service;
-    service.from_config(config);
-
-    if (!service.to_file(path + "/" + config.get_project_name() + ".service"))
+    if (!config.write_systemd_files(path))
     {
         std::cerr << "THERE WAS A PROBLEM WRITING SYSTEMD SERVICE TO '" << path << "'.\n";
         std::filesystem::remove_all(path);
@@ -109,17 +125,19 @@ void CLI::generate_config(
 
     config.to_file(path + "/config.cfg");
     std::cout << "\nSUCCESSFULLY CONFIGURED SERVER AND WROTE LOCAL CONFIG TO '" << path << "'.\n";
+    if (!config.is_job())
+        std::cout << "SERVICE READY AFTER " << config.get_time_to_ready().count() << " MS.\n";
 }
 
 bool CLI::create_project_dir(
     const std::string& project_name,
     const std::string& project_type) const
 {
-    std::string asyd_dir = get_home_dir() + "/.asyd/";
+    std::string asyd_dir = asyd::util::get_asyd_dir();
     if (!std::filesystem::exists(asyd_dir))
         std::filesystem::create_directory(asyd_dir);
 
-    std::string project_dir = this->get_asyd_project_dir(project_name);
+    std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
     if (std::filesystem::exists(project_dir))
         return false;
 
@@ -145,7 +163,7 @@ bool CLI::create_project_dir(
 
 bool CLI::remove_project(const std::string& project_name) const
 {
-    std::string project_home_dir = this->get_asyd_project_dir(project_name);
+    std::string project_home_dir = asyd::util::get_asyd_project_dir(project_name);
     if (!std::filesystem::exists(project_home_dir))
         return false;
 
@@ -153,73 +171,1221 @@ bool CLI::remove_project(const std::string& project_name) const
     config.from_file(project_home_dir + "config.cfg");
 
     Server server(config.get_server_hostname());
-    if (!server.remove_directory("~/.asyd/" + project_name))
+    server.set_is_root(config.get_service_username() == "sudo");
+    // including the staged and the previous version (see Project::stage())
+    std::string server_project_dir = "~/.asyd/" + project_name;
+    if (!server.remove_directory({ server_project_dir, server_project_dir + ".next", server_project_dir + ".prev" }))
+        return false;
+
+    // the timer goes first so it can't start the job while it's removed
+    if (config.is_job() && !server.remove_service(project_name + ".timer"))
+        return false;
+
+    // also if the socket was turned off but somehow survived
+    if (!server.remove_service(project_name + ".socket"))
+        return false;
+
+    // a template can't be stopped itself, only its instances (by pattern,
+    // so ones left over from an older scale-down are stopped too); both
+    // the plain and the template service are removed in case --instances
+    // changed at some point
+    if (!server.stop_service(project_name + "@*.service"))
         return false;
 
-    if (!server.remove_service(project_name + ".service"))
+    if (!server.remove_service(project_name + "@.service") || !server.remove_service(project_name + ".service"))
         return false;
 
     std::filesystem::remove_all(project_home_dir);
+    StatusCache("status-" + project_name).invalidate();
+    StatusCache("ls-" + config.get_server_hostname()).invalidate();
 
     std::cout << "SUCCESSFULLY REMOVED PROJECT '" << project_name << "' FROM SERVER AND LOCAL CONFIG.\n";
     return true;
 }
 
-bool CLI::service_action(const std::string& project_name, const std::string& action) const
+bool CLI::configure_project(
+    const std::string& project_name,
+    const std::map<std::string, std::string>& settings) const
 {
-    std::string project_dir = this->get_asyd_project_dir(project_name);
+    std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
     if (!std::filesystem::exists(project_dir))
         return false;
 
     Config config;
     config.from_file(project_dir + "config.cfg");
 
-    std::string service_name = project_name + ".service";
+    // units that aren't needed anymore after the update get disabled or
+    // removed, e.g., instances when scaling down
+    std::vector<std::string> previous_units = config.get_activation_units();
+    std::vector<std::string> previous_files = config.get_systemd_files();
 
-    Server server(config.get_server_hostname());
-    if (action == "start" && !server.start_service(service_name))
+    for (const auto& [key, value] : settings)
+    {
+        if (!config.is_setting(key))
+        {
+            std::cerr << "UNKNOWN SETTING '" << key << "'.\n";
+            return false;
+        }
+
+        if (!config.set(key, value))
+        {
+            std::string expected = Config::expected_value(key);
+            std::transform(expected.begin(), expected.end(), expected.begin(), ::toupper);
+            std::cerr << "INVALID VALUE '" << value << "' FOR '" << key << "', EXPECTED " << expected << ".\n";
+            return false;
+        }
+    }
+
+    if (!config.to_file(project_dir + "config.cfg"))
         return false;
-    else if (action == "stop" && !server.stop_service(service_name))
+
+    if (!config.write_systemd_files(project_dir))
         return false;
-    else if (action == "restart" && !server.restart_service(service_name))
+
+    Server server;
+    server.set_hostname(config.get_server_hostname());
+    server.set_is_root(config.get_service_username() == "sudo");
+
+    if (!config.copy_systemd_files(server, project_dir))
         return false;
 
-    std::string action_copy = action + "ed";
-    std::transform(action_copy.begin(), action_copy.end(), action_copy.begin(), ::toupper);
-    std::cout << "SUCCESSFULLY " << action_copy << " SERVICE '" << project_name << "'.\n";
+    if (!server.reload_service())
+        return false;
+
+    // instances and the service of a server that became socket activated
+    // or a job stay installed, they just mustn't start on their own anymore
+    std::vector<std::string> activation_units = config.get_activation_units();
+    for (const std::string& unit_name : previous_units)
+    {
+        if (std::find(activation_units.begin(), activation_units.end(), unit_name) != activation_units.end())
+            continue;
+
+        if (!server.disable_service(unit_name))
+            return false;
+    }
+
+    // unit files of the old setup, e.g., the socket without a listen stream
+    // (still enabled, it would take the server's port) or the plain service
+    // when going from 1 to more instances
+    std::vector<std::string> systemd_files = config.get_systemd_files();
+    for (const std::string& systemd_file : previous_files)
+    {
+        if (std::find(systemd_files.begin(), systemd_files.end(), systemd_file) != systemd_files.end())
+            continue;
+
+        if (!server.remove_service(systemd_file))
+            return false;
+
+        std::filesystem::remove(project_dir + systemd_file);
+    }
+
+    // new activation units (e.g., a server became socket activated) are
+    // enabled for the next boot; what runs now is left alone, a service the
+    // user stopped stays stopped
+    for (const std::string& unit_name : activation_units)
+    {
+        if (std::find(previous_units.begin(), previous_units.end(), unit_name) != previous_units.end())
+            continue;
 
+        if (!server.enable_service(unit_name))
+            return false;
+    }
+
+    // units may have been stopped or removed
+    StatusCache("status-" + project_name).invalidate();
+    StatusCache("ls-" + config.get_server_hostname()).invalidate();
+
+    std::cout << "SUCCESSFULLY UPDATED PROJECT '" << project_name << "'. RESTART THE SERVICE TO APPLY THE CHANGES.\n";
     return true;
 }
 
-bool CLI::start_service(const std::string& project_name) const
+bool CLI::watch_project(const std::string& project_name) const
 {
-    return this->service_action(project_name, "start");
+    std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
+    if (!std::filesystem::exists(project_dir))
+        return false;
+
+    Config config;
+    config.from_file(project_dir + "config.cfg");
+
+    // e.g., a project from asyd pull
+    if (config.get_working_directory().empty())
+    {
+        std::cerr << "NO working_directory SET IN " << project_dir << "config.cfg.\n";
+        return false;
+    }
+
+    std::string server_project_dir = config.get_server_home_directory() + "/.asyd/" + project_name;
+
+    Watcher watcher(config.get_working_directory());
+    if (!watcher.start())
+    {
+        std::cerr << "COULDN'T WATCH '" << config.get_working_directory() << "' FOR CHANGES.\n";
+        return false;
+    }
+
+    Server server;
+    server.set_hostname(config.get_server_hostname());
+    server.set_is_root(config.get_service_username() == "sudo");
+
+    // the cipher is negotiated when the connection is opened
+    config.tune_transfer(server);
+
+    if (!server.open_connection())
+    {
+        std::cerr << "COULDN'T CONNECT TO '" << config.get_server_hostname() << "'.\n";
+        return false;
+    }
+
+    // stop cleanly on CTRL+C so the persistent connection gets closed;
+    // the interrupt makes the blocking wait in the watcher return
+    struct sigaction action = {};
+    action.sa_handler = on_interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "WATCHING '" << config.get_working_directory() << "' FOR CHANGES (CTRL+C TO STOP).\n";
+
+    while (!interrupted)
+    {
+        std::vector<std::string> changed_paths;
+        std::chrono::steady_clock::time_point first_change;
+        if (!watcher.wait_for_changes(changed_paths, first_change))
+            break;
+
+        // changes may have been missed after an overflow, so the whole tree
+        // is copied (the stat cache keeps sizing it cheap)
+        bool synced = false;
+        if (watcher.missed_changes())
+        {
+            Scanner scanner(config.get_working_directory(), project_dir + "scan.cache");
+            synced = scanner.scan(false)
+                && server.copy_from_local(config.get_working_directory(), server_project_dir, scanner.get_total_size());
+        }
+        else
+            synced = server.copy_from_local(config.get_working_directory(), server_project_dir, changed_paths);
+        if (!synced)
+        {
+            std::cerr << "FAILED TO SYNC CHANGES TO '" << config.get_server_hostname() << "'.\n";
+            continue;
+        }
+
+        if (std::find(changed_paths.begin(), changed_paths.end(), config.get_entry_point()) != changed_paths.end()
+            && !server.chmod("+x", server_project_dir + "/" + config.get_entry_point()))
+        {
+            std::cerr << "FAILED TO MAKE ENTRY POINT EXECUTABLE.\n";
+            continue;
+        }
+
+        ChangeAction action;
+        std::chrono::milliseconds time_to_ready(0);
+        if (!config.apply_changes(server, changed_paths, action, time_to_ready))
+        {
+            std::cerr << "FAILED TO RESTART/RELOAD SERVICE '" << project_name << "'.\n";
+            continue;
+        }
+
+        auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - first_change);
+
+        std::cout << "SYNCED " << changed_paths.size() << " CHANGED PATH(S) OF '" << project_name << "'";
+        if (action == ChangeAction::RESTART)
+            std::cout << " AND RESTARTED THE SERVICE (CHANGE-TO-RESTART: " << latency.count()
+                << " MS, READY AFTER " << time_to_ready.count() << " MS)";
+        else if (action == ChangeAction::RELOAD)
+            std::cout << " AND RELOADED THE SERVICE (CHANGE-TO-RELOAD: " << latency.count() << " MS)";
+        else
+            std::cout << " (NO RESTART NEEDED)";
+        std::cout << ".\n";
+    }
+
+    server.close_connection();
+    return interrupted != 0;
 }
 
-bool CLI::stop_service(const std::string& project_name) const
+bool CLI::scan_project(const std::string& project_name) const
 {
-    return this->service_action(project_name, "stop");
+    std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
+    if (!std::filesystem::exists(project_dir))
+        return false;
+
+    Config config;
+    config.from_file(project_dir + "config.cfg");
+
+    Scanner scanner(config.get_working_directory(), project_dir + "scan.cache");
+    if (!scanner.scan())
+    {
+        std::cerr << "COULDN'T SCAN '" << config.get_working_directory() << "'.\n";
+        return false;
+    }
+
+    const Scanner::Stats& stats = scanner.get_stats();
+    std::cout << "SCANNED " << stats.files << " FILE(S) OF '" << project_name << "' IN "
+        << stats.duration.count() << " MS (HASHED " << stats.files_hashed << " FILE(S), "
+        << stats.bytes_hashed << " BYTES).\n";
+    return true;
 }
 
-bool CLI::restart_service(const std::string& project_name) const
+bool CLI::measure_link(const std::string& hostname) const
 {
-    return this->service_action(project_name, "restart");
+    Server server;
+    server.set_hostname(hostname);
+
+    if (!server.open_connection())
+    {
+        std::cerr << "COULDN'T CONNECT TO '" << hostname << "'.\n";
+        return false;
+    }
+
+    Link link(hostname);
+    bool measured = link.measure(server);
+    server.close_connection();
+
+    if (!measured)
+        return false;
+
+    TransferSettings settings = link.choose();
+    std::cout << "LINK TO '" << hostname << "': ROUND TRIP " << link.get_round_trip().count() / 1000.0
+        << " MS, THROUGHPUT " << static_cast<long long>(link.get_throughput() / 1024) << " KB/S.\n";
+    std::cout << "   *   compression: " << (settings.compression_level > 0 ? std::to_string(settings.compression_level) : "none") << "\n";
+    std::cout << "   *   cipher: " << (settings.ciphers.length() > 0 ? settings.ciphers : "ssh default") << "\n";
+    std::cout << "   *   streams: " << settings.streams << "\n";
+    return true;
 }
 
-bool CLI::check_status(const std::string& project_name, std::string& output) const
+// project of a unit name without "asyd-" (e.g., "api.v2@3.service" ->
+// "api.v2"); project names may contain dots, so only the unit type and
+// the instance are removed
+static std::string get_unit_project(const std::string& unit_name)
 {
-    std::string project_dir = this->get_asyd_project_dir(project_name);
-    if (!std::filesystem::exists(project_dir))
+    std::string project_name = unit_name;
+    for (const std::string suffix : { ".service", ".socket", ".timer" })
+    {
+        if (project_name.length() > suffix.length()
+            && project_name.compare(project_name.length() - suffix.length(), suffix.length(), suffix) == 0)
+        {
+            project_name.erase(project_name.length() - suffix.length());
+            break;
+        }
+    }
+
+    // "@N" of an instance, "@" of a template
+    size_t instance = project_name.rfind('@');
+    if (instance != std::string::npos && project_name.find_first_not_of("0123456789", instance + 1) == std::string::npos)
+        project_name.erase(instance);
+
+    return project_name;
+}
+
+// e.g., 1.5G; "-" for values that aren't known
+static std::string format_bytes(double bytes)
+{
+    if (bytes < 0)
+        return "-";
+
+    const char* units[] = { "B", "K", "M", "G", "T" };
+    size_t unit = 0;
+    while (bytes >= 1024 && unit < 4)
+    {
+        bytes /= 1024;
+        unit++;
+    }
+
+    std::ostringstream formatted;
+    formatted << std::fixed << std::setprecision(unit == 0 ? 0 : 1) << bytes << units[unit];
+    return formatted.str();
+}
+
+static std::string format_number(double value, int precision)
+{
+    if (value < 0)
+        return "-";
+
+    std::ostringstream formatted;
+    formatted << std::fixed << std::setprecision(precision) << value;
+    return formatted.str();
+}
+
+static void sort_units(std::vector<Monitor::UnitStats>& stats, const std::string& sort_key)
+{
+    // descending for usage, ascending for names
+    std::sort(stats.begin(), stats.end(), [&](const Monitor::UnitStats& a, const Monitor::UnitStats& b) {
+        if (sort_key == "memory" && a.memory_bytes != b.memory_bytes)
+            return a.memory_bytes > b.memory_bytes;
+        if (sort_key == "io" && a.io_read_rate + a.io_write_rate != b.io_read_rate + b.io_write_rate)
+            return a.io_read_rate + a.io_write_rate > b.io_read_rate + b.io_write_rate;
+        if (sort_key == "tasks" && a.tasks != b.tasks)
+            return a.tasks > b.tasks;
+        if (sort_key == "restarts" && a.restarts != b.restarts)
+            return a.restarts > b.restarts;
+        if (sort_key == "cpu" && a.cpu_percent != b.cpu_percent)
+            return a.cpu_percent > b.cpu_percent;
+
+        return std::tie(a.unit_name, a.hostname) < std::tie(b.unit_name, b.hostname);
+    });
+}
+
+static void render_top(
+    std::vector<Monitor::UnitStats>& stats,
+    size_t hosts,
+    size_t unreachable,
+    int interval_sec,
+    const std::string& sort_key)
+{
+    sort_units(stats, sort_key);
+
+    std::string sort_name = sort_key;
+    std::transform(sort_name.begin(), sort_name.end(), sort_name.begin(), ::toupper);
+
+    // clears the screen and moves the cursor to the top
+    std::cout << "\033[2J\033[H";
+    std::cout << "ASYD TOP - " << stats.size() << " SERVICE(S) ON " << hosts << " HOST(S)";
+    if (unreachable > 0)
+        std::cout << " (" << unreachable << " UNREACHABLE)";
+    std::cout << ", EVERY " << interval_sec << "S, SORTED BY " << sort_name << "\n";
+    std::cout << "[c]pu [m]emory [i]o [t]asks [r]estarts [n]ame [q]uit\n\n";
+
+    std::cout << std::left << std::setw(28) << "SERVICE" << std::setw(24) << "HOST" << std::setw(12) << "STATE"
+        << std::right << std::setw(8) << "CPU%" << std::setw(10) << "MEMORY" << std::setw(7) << "TASKS"
+        << std::setw(10) << "READ/S" << std::setw(10) << "WRITE/S" << std::setw(10) << "RESTARTS" << "\n";
+
+    for (const Monitor::UnitStats& unit : stats)
+    {
+        std::cout << std::left << std::setw(28) << unit.unit_name.substr(0, 27)
+            << std::setw(24) << unit.hostname.substr(0, 23)
+            << std::setw(12) << unit.state
+            << std::right << std::setw(8) << format_number(unit.cpu_percent, 1)
+            << std::setw(10) << format_bytes(unit.memory_bytes)
+            << std::setw(7) << format_number(unit.tasks, 0)
+            << std::setw(10) << format_bytes(unit.io_read_rate)
+            << std::setw(10) << format_bytes(unit.io_write_rate)
+            << std::setw(10) << format_number(unit.restarts, 0) << "\n";
+    }
+
+    std::cout << std::flush;
+}
+
+bool CLI::top(
+    const std::vector<std::string>& patterns,
+    int interval_sec,
+    const std::string& sort_key) const
+{
+    std::vector<std::string> project_names = asyd::find_projects(patterns.empty() ? std::vector<std::string>{ "*" } : patterns);
+    if (project_names.empty())
+    {
+        std::cerr << "NO MATCHING PROJECTS.\n";
+        return false;
+    }
+
+    // one monitored server per host and kind of units (system/user); the
+    // units of the matching projects are shown
+    std::set<std::pair<std::string, bool>> hosts;
+    std::set<std::string> projects(project_names.begin(), project_names.end());
+    Monitor monitor;
+
+    for (const std::string& project_name : project_names)
+    {
+        Config config;
+        if (!config.from_file(asyd::util::get_asyd_project_dir(project_name) + "config.cfg"))
+            continue;
+
+        bool is_root = config.get_service_username() == "sudo";
+        if (!hosts.insert({ config.get_server_hostname(), is_root }).second)
+            continue;
+
+        Server server;
+        server.set_hostname(config.get_server_hostname());
+        server.set_is_root(is_root);
+        monitor.add_server(server);
+    }
+
+    monitor.open();
+
+    struct sigaction action = {};
+    action.sa_handler = on_interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    // single keys without enter or echo to change the sorting
+    bool is_terminal = isatty(STDIN_FILENO);
+    struct termios original_mode;
+    if (is_terminal)
+    {
+        tcgetattr(STDIN_FILENO, &original_mode);
+        struct termios key_mode = original_mode;
+        key_mode.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &key_mode);
+    }
+
+    const std::map<char, std::string> sort_keys = {
+        { 'c', "cpu" }, { 'm', "memory" }, { 'i', "io" }, { 't', "tasks" }, { 'r', "restarts" }, { 'n', "name" },
+    };
+    std::string current_sort_key = sort_key;
+    std::vector<Monitor::UnitStats> stats;
+
+    while (!interrupted)
+    {
+        std::vector<Monitor::UnitStats> sampled;
+        size_t unreachable = monitor.sample(sampled);
+
+        // instances (project@N) belong to their project
+        stats.clear();
+        for (const Monitor::UnitStats& unit : sampled)
+        {
+            std::string project_name = get_unit_project(unit.unit_name);
+            if (patterns.empty() || projects.count(project_name) > 0)
+                stats.push_back(unit);
+        }
+
+        render_top(stats, hosts.size(), unreachable, interval_sec, current_sort_key);
+
+        // waits for the next tick, re-rendering right away on a sort key
+        auto next_sample = std::chrono::steady_clock::now() + std::chrono::seconds(interval_sec);
+        while (!interrupted)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(next_sample - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0)
+                break;
+
+            struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+            if (poll(&input, is_terminal ? 1 : 0, remaining.count()) <= 0)
+                continue;
+
+            char key;
+            if (read(STDIN_FILENO, &key, 1) != 1)
+                continue;
+
+            if (key == 'q')
+                interrupted = 1;
+            else if (sort_keys.count(key) > 0)
+            {
+                current_sort_key = sort_keys.at(key);
+                render_top(stats, hosts.size(), unreachable, interval_sec, current_sort_key);
+            }
+        }
+    }
+
+    if (is_terminal)
+        tcsetattr(STDIN_FILENO, TCSANOW, &original_mode);
+
+    monitor.close();
+    return true;
+}
+
+bool CLI::logs(
+    const std::vector<std::string>& patterns,
+    int lines,
+    bool follow,
+    int reorder_window_ms) const
+{
+    auto matches = [&patterns](const std::string& name) {
+        for (const std::string& pattern : patterns)
+            if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0)
+                return true;
+        return false;
+    };
+
+    // one connection per host (and kind of units/jump host), shared by
+    // all sources on that host
+    std::map<std::string, Server> connections;
+    LogMerger merger{ std::chrono::milliseconds(reorder_window_ms) };
+    size_t source_count = 0;
+
+    for (const std::string& project_name : asyd::find_projects({ "*" }))
+    {
+        Config config;
+        if (!config.from_file(asyd::util::get_asyd_project_dir(project_name) + "config.cfg"))
+            continue;
+
+        bool is_root = config.get_service_username() == "sudo";
+        const std::string& jump_host = config.get_relay_hostname();
+        std::vector<std::string> hostnames = jump_host.empty()
+            ? std::vector<std::string>{ config.get_server_hostname() }
+            : config.get_relay_targets();
+
+        for (const std::string& hostname : hostnames)
+        {
+            if (!matches(project_name) && !matches(hostname))
+                continue;
+
+            std::string key = hostname + "|" + (is_root ? "root" : "user") + "|" + jump_host;
+            if (connections.count(key) == 0)
+            {
+                Server server;
+                server.set_hostname(hostname);
+                server.set_is_root(is_root);
+                if (!jump_host.empty())
+                    server.set_jump_host(jump_host);
+
+                // streams still work without, just with a connection each
+                if (!server.open_connection())
+                    std::cerr << "COULDN'T OPEN A PERSISTENT CONNECTION TO " << hostname << ".\n";
+
+                connections[key] = server;
+            }
+
+            merger.add_source(connections[key], { config.get_status_unit() }, project_name + "@" + hostname);
+            source_count++;
+        }
+    }
+
+    if (source_count == 0)
+    {
+        std::cerr << "NO MATCHING PROJECTS OR HOSTS.\n";
         return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = on_interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    merger.run(lines, follow, [](const LogMerger::Entry& entry) {
+        std::time_t seconds = entry.timestamp_us / 1000000;
+        std::tm local_time;
+        localtime_r(&seconds, &local_time);
+
+        std::cout << std::put_time(&local_time, "%H:%M:%S")
+            << "." << std::setfill('0') << std::setw(3) << (entry.timestamp_us / 1000) % 1000 << std::setfill(' ')
+            << " [" << entry.source << "] " << entry.message << std::endl;
+    }, []() { return !interrupted; });
+
+    for (auto& [key, server] : connections)
+        server.close_connection();
+
+    return true;
+}
+
+// a project's systemd files as found in a pulled archive
+struct PulledProject
+{
+    std::vector<std::filesystem::path> unit_files;
+    size_t enabled_instances = 0;
+    bool is_root = false;
+    std::string home_directory;
+};
+
+// groups the asyd units below [root] (an extracted Server::fetch_unit_files()
+// archive) by project
+static std::map<std::string, PulledProject> read_pulled_units(const std::filesystem::path& root)
+{
+    std::map<std::string, PulledProject> projects;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root, error))
+    {
+        std::string filename = entry.path().filename().string();
+        if (filename.rfind("asyd-", 0) != 0 || entry.is_directory())
+            continue;
+
+        // asyd-name.service, asyd-name@.service, asyd-name@N.service, .timer or .socket
+        std::string unit_name = filename.substr(5);
+        std::string project_name = get_unit_project(unit_name);
+        PulledProject& project = projects[project_name];
+
+        // the symlinks in *.wants enable units, the instances of a template
+        // are only known from them
+        if (entry.path().parent_path().extension() == ".wants")
+        {
+            if (unit_name.find('@') != std::string::npos)
+                project.enabled_instances++;
+            continue;
+        }
+
+        project.unit_files.push_back(entry.path());
 
+        std::string relative_path = std::filesystem::relative(entry.path(), root).string();
+        project.is_root = relative_path.rfind("etc/systemd/system/", 0) == 0;
+        if (!project.is_root)
+            project.home_directory = "/" + relative_path.substr(0, relative_path.find("/.config/systemd/user/"));
+    }
+
+    return projects;
+}
+
+bool CLI::pull(
+    const std::vector<std::string>& hostnames,
+    const std::vector<std::string>& patterns) const
+{
+    // hosts are fetched in parallel, each into its own temporary directory
+    std::vector<std::future<std::pair<bool, std::string>>> fetches;
+    for (const std::string& hostname : hostnames)
+    {
+        fetches.push_back(std::async(std::launch::async, [hostname]() {
+            char directory_template[] = "/tmp/asyd-pull-XXXXXX";
+            if (mkdtemp(directory_template) == nullptr)
+                return std::make_pair(false, std::string());
+
+            std::string directory = directory_template;
+            std::filesystem::create_directory(directory + "/root");
+
+            Server server;
+            server.set_hostname(hostname);
+
+            Command extract;
+            extract.add("tar -xf " + directory + "/units.tar -C " + directory + "/root");
+
+            bool fetched = server.fetch_unit_files(directory + "/units.tar") && extract.execute();
+            return std::make_pair(fetched, directory);
+        }));
+    }
+
+    auto matches = [&patterns](const std::string& project_name) {
+        if (patterns.empty())
+            return true;
+
+        for (const std::string& pattern : patterns)
+            if (fnmatch(pattern.c_str(), project_name.c_str(), 0) == 0)
+                return true;
+        return false;
+    };
+
+    std::string asyd_dir = asyd::util::get_asyd_dir();
+    if (!std::filesystem::exists(asyd_dir))
+        std::filesystem::create_directory(asyd_dir);
+
+    // a project on several hosts is taken from the first one
+    std::map<std::string, std::string> pulled_from;
+    bool all_pulled = true;
+
+    for (size_t i = 0; i < hostnames.size(); ++i)
+    {
+        const std::string& hostname = hostnames[i];
+        auto [fetched, directory] = fetches[i].get();
+
+        if (!fetched)
+        {
+            std::cerr << "COULDN'T FETCH THE SERVICES OF " << hostname << ".\n";
+            if (directory.length() > 0)
+                std::filesystem::remove_all(directory);
+            all_pulled = false;
+            continue;
+        }
+
+        size_t project_count = 0;
+        for (const auto& [project_name, pulled] : read_pulled_units(directory + "/root"))
+        {
+            if (pulled.unit_files.empty() || !matches(project_name))
+                continue;
+
+            if (pulled_from.count(project_name) > 0)
+            {
+                std::cerr << "'" << project_name << "' IS ALSO ON " << hostname << ", KEEPING THE ONE FROM " << pulled_from[project_name] << ".\n";
+                continue;
+            }
+
+            std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
+            bool is_new = !std::filesystem::exists(project_dir + "config.cfg");
+
+            Config config;
+            if (!is_new)
+                config.from_file(project_dir + "config.cfg");
+            config.set_project_name(project_name);
+            config.set_server_hostname(hostname);
+
+            // user units run as the user owning the home directory they're in
+            std::string username = hostname.find('@') != std::string::npos
+                ? hostname.substr(0, hostname.find('@'))
+                : std::filesystem::path(pulled.home_directory).filename().string();
+            config.set_service_username(pulled.is_root ? "sudo" : username);
+
+            Systemd systemd;
+            for (const std::filesystem::path& unit_file : pulled.unit_files)
+                systemd.from_file(unit_file.string());
+            systemd.to_config(config);
+
+            // the enabled instances of a template are the ones that run
+            if (config.is_templated() && pulled.enabled_instances > 1)
+                config.set_instances(std::to_string(pulled.enabled_instances));
+
+            std::filesystem::create_directory(project_dir);
+            if (!config.to_file(project_dir + "config.cfg") || !config.write_systemd_files(project_dir))
+            {
+                std::cerr << "COULDN'T WRITE THE CONFIG OF '" << project_name << "'.\n";
+                all_pulled = false;
+                continue;
+            }
+
+            if (is_new)
+                std::cout << "PULLED NEW PROJECT '" << project_name << "' - SET ITS working_directory IN " << project_dir << "config.cfg BEFORE DEPLOYING.\n";
+
+            pulled_from[project_name] = hostname;
+            project_count++;
+        }
+
+        std::cout << "PULLED " << project_count << " PROJECT(S) FROM " << hostname << ".\n";
+        std::filesystem::remove_all(directory);
+    }
+
+    return all_pulled;
+}
+
+bool CLI::apply(const std::string& manifest_path) const
+{
+    Manifest manifest;
+    if (!manifest.from_file(manifest_path))
+    {
+        std::cerr << "INVALID MANIFEST: " << manifest.get_error() << "\n";
+        return false;
+    }
+
+    if (manifest.get_projects().empty())
+    {
+        std::cerr << "NO PROJECTS IN MANIFEST.\n";
+        return false;
+    }
+
+    struct AppliedProject
+    {
+        Config config;
+        std::string project_dir;
+        bool is_new = false;
+        bool applied = false;
+        std::string error;
+    };
+
+    // the projects' configs on top of the existing ones, grouped by host
+    // (and kind of units) in manifest order
+    std::vector<AppliedProject> projects;
+    std::map<std::string, std::vector<size_t>> hosts;
+
+    for (const Manifest::Project& declared : manifest.get_projects())
+    {
+        AppliedProject project;
+        project.project_dir = asyd::util::get_asyd_project_dir(declared.name);
+        project.is_new = !std::filesystem::exists(project.project_dir + "config.cfg");
+
+        // the same defaults as the prompts of a new project
+        if (project.is_new)
+            project.config.set_service_username("sudo");
+        else
+            project.config.from_file(project.project_dir + "config.cfg");
+
+        project.config.set_project_name(declared.name);
+        for (const auto& [key, value] : declared.settings)
+            project.config.set(key, value);
+
+        if (project.is_new && project.config.is_job() && project.config.get_randomized_delay_sec().empty())
+            project.config.set_randomized_delay_sec("1min");
+
+        bool is_root = project.config.get_service_username() == "sudo";
+        hosts[project.config.get_server_hostname() + "|" + (is_root ? "root" : "user")].push_back(projects.size());
+        projects.push_back(project);
+    }
+
+    std::string asyd_dir = asyd::util::get_asyd_dir();
+    if (!std::filesystem::exists(asyd_dir))
+        std::filesystem::create_directory(asyd_dir);
+
+    auto apply_host = [&projects](const std::vector<size_t>& indices) {
+        // the connection uses the transfer settings of the host's first project
+        const Config& first = projects[indices.front()].config;
+        Server server;
+        server.set_hostname(first.get_server_hostname());
+        server.set_is_root(first.get_service_username() == "sudo");
+        first.tune_transfer(server);
+
+        bool is_connected = server.open_connection();
+
+        bool needs_info = false;
+        for (size_t index : indices)
+            needs_info = needs_info
+                || projects[index].config.get_server_home_directory().empty()
+                || projects[index].config.get_server_bash_directory().empty();
+
+        if (needs_info && !server.fetch_info())
+        {
+            for (size_t index : indices)
+                projects[index].error = "couldn't fetch the server info";
+
+            if (is_connected)
+                server.close_connection();
+            return;
+        }
+
+        for (size_t index : indices)
+        {
+            AppliedProject& project = projects[index];
+            if (project.config.get_server_home_directory().empty())
+                project.config.set_server_home_directory(server.get_home());
+            if (project.config.get_server_bash_directory().empty())
+                project.config.set_server_bash_directory(server.get_bash());
+
+            std::filesystem::create_directory(project.project_dir);
+            if (!project.config.to_file(project.project_dir + "config.cfg")
+                || !project.config.write_systemd_files(project.project_dir))
+                project.error = "couldn't write the local config";
+            else if (!project.config.setup_server(server, project.project_dir))
+                project.error = "couldn't set up the server";
+            else
+                project.applied = project.config.to_file(project.project_dir + "config.cfg");
+
+            // a new project that failed can be applied again from scratch
+            if (!project.applied && project.is_new)
+                std::filesystem::remove_all(project.project_dir);
+        }
+
+        if (is_connected)
+            server.close_connection();
+    };
+
+    std::vector<std::future<void>> setups;
+    for (const auto& [host, indices] : hosts)
+        setups.push_back(std::async(std::launch::async, apply_host, std::cref(indices)));
+
+    for (std::future<void>& setup : setups)
+        setup.get();
+
+    size_t applied_count = 0;
+    for (const AppliedProject& project : projects)
+    {
+        const std::string& name = project.config.get_project_name();
+        const std::string& hostname = project.config.get_server_hostname();
+
+        if (project.applied)
+        {
+            applied_count++;
+            std::cout << (project.is_new ? "CREATED " : "UPDATED ") << name << " ON " << hostname << ".\n";
+        }
+        else
+            std::cerr << "FAILED " << name << " ON " << hostname << ": " << project.error << ".\n";
+    }
+
+    std::cout << "APPLIED " << applied_count << " OF " << projects.size() << " PROJECT(S).\n";
+    return applied_count == projects.size();
+}
+
+// prints a (possibly cached) answer, marking how old it is
+static void print_cached(const std::string& output, long age_sec)
+{
+    std::cout << output << (output.empty() || output.back() == '\n' ? "" : "\n");
+
+    if (age_sec > 0)
+        std::cerr << "(AS OF " << age_sec << "S AGO" << (age_sec >= StatusCache::REVALIDATE_AFTER_SEC ? ", REFRESHING" : "") << ")\n";
+}
+
+// the live reads of status() and list_services()
+static StatusCache::read_fn read_status(const Project& project)
+{
+    return [&project](std::string& live_output) {
+        Result status = project.status();
+        live_output = status.output;
+        return status.ok();
+    };
+}
+
+static StatusCache::read_fn read_services(const Server& server)
+{
+    return [&server](std::string& live_output) { return server.list_services(live_output); };
+}
+
+// the cache of a status() or list_services() answer, refreshed by this
+// executable (see refresh_cached())
+static StatusCache cache_of(const std::string& kind, const std::string& name)
+{
+    StatusCache cache(kind + "-" + name);
+
+    std::error_code error;
+    std::string executable = std::filesystem::read_symlink("/proc/self/exe", error).string();
+    if (!error)
+        cache.set_refresher({ executable, "__refresh", kind, name });
+
+    return cache;
+}
+
+bool CLI::status(const std::string& project_name, bool fresh) const
+{
+    Project project;
+    Result result = project.load(project_name);
+    if (!result.ok())
+    {
+        std::cerr << "Couldn't status '" << project_name << "': " << result.message << ".\n";
+        return false;
+    }
+
+    std::string output;
+    long age_sec = 0;
+    StatusCache cache = cache_of("status", project_name);
+
+    bool read = cache.read(read_status(project), fresh, output, age_sec);
+
+    if (!read)
+    {
+        std::cerr << "Couldn't status '" << project_name << "': couldn't check status for service '" << project_name << "'.\n";
+        return false;
+    }
+
+    print_cached(output, age_sec);
+    return true;
+}
+
+bool CLI::list_services(const std::string& hostname, bool fresh) const
+{
+    Server server;
+    server.set_hostname(hostname);
+
+    std::string output;
+    long age_sec = 0;
+    StatusCache cache = cache_of("ls", hostname);
+
+    if (!cache.read(read_services(server), fresh, output, age_sec))
+    {
+        std::cerr << "Couldn't list services.\n";
+        return false;
+    }
+
+    print_cached(output, age_sec);
+    return true;
+}
+
+bool CLI::refresh_cached(const std::string& kind, const std::string& name) const
+{
+    // the process that started us waits until we're detached
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid > 0;
+
+    StatusCache cache(kind + "-" + name);
+    if (kind == "status")
+    {
+        Project project;
+        std::exit(project.load(name).ok() && cache.refresh(read_status(project)) ? 0 : 1);
+    }
+
+    Server server;
+    server.set_hostname(name);
+    std::exit(kind == "ls" && cache.refresh(read_services(server)) ? 0 : 1);
+}
+
+// e.g., 12.3s, 4m05s or 2h10m; "-" for values that aren't known
+static std::string format_duration(double seconds)
+{
+    if (seconds < 0)
+        return "-";
+
+    std::ostringstream formatted;
+    if (seconds < 60)
+        formatted << std::fixed << std::setprecision(1) << seconds << "s";
+    else if (seconds < 3600)
+        formatted << static_cast<int>(seconds) / 60 << "m" << std::setfill('0') << std::setw(2) << static_cast<int>(seconds) % 60 << "s";
+    else
+        formatted << static_cast<int>(seconds) / 3600 << "h" << std::setfill('0') << std::setw(2) << static_cast<int>(seconds) % 3600 / 60 << "m";
+    return formatted.str();
+}
+
+bool CLI::runs(const std::string& project_name, size_t max_runs) const
+{
     Config config;
-    config.from_file(project_dir + "config.cfg");
+    if (!config.from_file(asyd::util::get_asyd_project_dir(project_name) + "config.cfg"))
+    {
+        std::cerr << "Couldn't read config of project '" << project_name << "'.\n";
+        return false;
+    }
 
-    std::string service_name = project_name + ".service";
+    if (!config.is_job())
+    {
+        std::cerr << "'" << project_name << "' isn't a job.\n";
+        return false;
+    }
 
-    Server server(config.get_server_hostname());
-    if (!server.check_status(service_name, output))
+    // Server(hostname) would fetch the server's info first
+    Server server;
+    server.set_hostname(config.get_server_hostname());
+    server.set_is_root(config.get_service_username() == "sudo");
+
+    JobHistory history(project_name + ".service", config.get_schedule());
+    if (!history.fetch(server, max_runs))
+    {
+        std::cerr << "Couldn't fetch the runs of '" << project_name << "' from '" << config.get_server_hostname() << "'.\n";
         return false;
+    }
+
+    const std::vector<JobHistory::Run>& runs = history.get_runs();
+    double fraction = config.get_overrun_fraction();
+    int64_t interval_sec = history.get_interval_sec();
+
+    std::cout << "RUNS OF '" << project_name << "' ON " << config.get_server_hostname()
+        << " (SCHEDULE '" << config.get_schedule() << "'"
+        << (interval_sec > 0 ? ", EVERY " + format_duration(interval_sec) : "") << "):\n";
+
+    std::cout << std::left << std::setw(21) << "STARTED" << std::setw(10) << "RESULT"
+        << std::right << std::setw(10) << "DURATION" << std::setw(10) << "CPU" << std::setw(10) << "MEMORY"
+        << std::setw(10) << "READ" << std::setw(10) << "WRITE" << "\n";
+
+    size_t overruns = 0;
+    for (const JobHistory::Run& run : runs)
+    {
+        std::time_t started = run.started_us / 1000000;
+        std::tm local_time;
+        localtime_r(&started, &local_time);
+
+        std::string result = run.is_running() ? "RUNNING"
+            : run.succeeded ? "OK"
+            : run.exit_status >= 0 ? "EXIT " + std::to_string(run.exit_status)
+            : run.exit_code.empty() ? "FAILED" : run.exit_code;
+
+        std::ostringstream started_at;
+        started_at << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S");
+
+        double duration_sec = history.get_duration_sec(run);
+        std::cout << std::left << std::setw(21) << started_at.str() << std::setw(10) << result
+            << std::right << std::setw(10) << format_duration(duration_sec)
+            << std::setw(10) << format_duration(run.cpu_usage_nsec < 0 ? -1 : run.cpu_usage_nsec / 1e9)
+            << std::setw(10) << format_bytes(run.memory_peak_bytes)
+            << std::setw(10) << format_bytes(run.io_read_bytes)
+            << std::setw(10) << format_bytes(run.io_write_bytes);
+
+        if (history.is_overrun(run, fraction))
+        {
+            std::cout << "  OVERRUN (" << static_cast<int>(100 * duration_sec / interval_sec) << "% OF INTERVAL)";
+            overruns++;
+        }
+        std::cout << "\n";
+    }
+
+    if (runs.empty())
+    {
+        std::cout << "NO RUNS IN THE JOURNAL.\n";
+        return true;
+    }
+
+    std::cout << "DURATION P50 " << format_duration(history.get_duration_percentile(50))
+        << "  P90 " << format_duration(history.get_duration_percentile(90))
+        << "  P99 " << format_duration(history.get_duration_percentile(99))
+        << "  MAX " << format_duration(history.get_duration_percentile(100)) << "\n";
+
+    if (interval_sec > 0)
+        std::cout << overruns << " OF " << runs.size() << " RUN(S) TOOK LONGER THAN "
+            << static_cast<int>(100 * fraction) << "% OF THE SCHEDULE INTERVAL.\n";
 
     return true;
 }
+
+// a host of a project that an ad-hoc command runs on
+struct ExecTarget
+{
+    std::string label;      // project@host
+    Server server;
+    std::string directory;
+
+    // 0 until started, 1 while running and 2 once done
+    std::atomic<int> state{ 0 };
+    std::atomic<bool> cancelled{ false };
+    std::chrono::steady_clock::time_point deadline;
+    bool timed_out = false;
+    int exit_status = -1;
+};
+
+bool CLI::exec(
+    const std::vector<std::string>& patterns,
+    const std::string& command,
+    size_t max_parallel,
+    int timeout_sec) const
+{
+    // a deque, so the targets (atomics) never move
+    std::deque<ExecTarget> targets;
+    for (const std::string& project_name : asyd::find_projects(patterns))
+    {
+        Config config;
+        if (!config.from_file(asyd::util::get_asyd_project_dir(project_name) + "config.cfg"))
+            continue;
+
+        const std::string& jump_host = config.get_relay_hostname();
+        std::vector<std::string> hostnames = jump_host.empty()
+            ? std::vector<std::string>{ config.get_server_hostname() }
+            : config.get_relay_targets();
+
+        for (const std::string& hostname : hostnames)
+        {
+            ExecTarget& target = targets.emplace_back();
+            target.label = project_name + "@" + hostname;
+            target.server.set_hostname(hostname);
+            target.server.set_is_root(config.get_service_username() == "sudo");
+            if (!jump_host.empty())
+                target.server.set_jump_host(jump_host);
+            target.directory = config.get_server_home_directory() + "/.asyd/" + project_name;
+        }
+    }
+
+    if (targets.empty())
+    {
+        std::cerr << "NO MATCHING PROJECTS.\n";
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = on_interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::mutex output_mutex;
+    std::atomic<size_t> next_target{ 0 };
+    auto run_targets = [&]() {
+        size_t index;
+        while ((index = next_target++) < targets.size() && !interrupted)
+        {
+            ExecTarget& target = targets[index];
+
+            // the command is killed on the server after the timeout; the
+            // grace period here covers an ssh connection that hangs
+            target.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec + 15);
+            target.state = 1;
+
+            target.server.run_command(target.directory, command, timeout_sec, [&](const std::string& line) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                std::cout << "[" << target.label << "] " << line << std::endl;
+                return true;
+            }, &target.cancelled, target.exit_status);
+
+            target.state = 2;
+        }
+    };
+
+    std::vector<std::future<void>> workers;
+    for (size_t i = 0; i < std::min(std::max<size_t>(max_parallel, 1), targets.size()); ++i)
+        workers.push_back(std::async(std::launch::async, run_targets));
+
+    // cancels the commands that ran out of time or all of them when
+    // interrupted, until every worker is done
+    for (std::future<void>& worker : workers)
+    {
+        while (worker.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready)
+        {
+            auto now = std::chrono::steady_clock::now();
+            for (ExecTarget& target : targets)
+            {
+                if (target.state != 1 || target.cancelled)
+                    continue;
+
+                if (timeout_sec > 0 && now > target.deadline)
+                    target.timed_out = true;
+                if (target.timed_out || interrupted)
+                    target.cancelled = true;
+            }
+        }
+    }
+
+    std::cout << "\nEXIT CODES:\n";
+    size_t succeeded = 0;
+    for (const ExecTarget& target : targets)
+    {
+        std::cout << "  " << std::left << std::setw(40) << target.label << " ";
+        if (target.state != 2)
+            std::cout << "NOT RUN";
+        else if (target.timed_out || target.exit_status == 124)
+            std::cout << "TIMED OUT";
+        else if (target.cancelled)
+            std::cout << "CANCELLED";
+        else if (target.exit_status == 255)
+            std::cout << "255 (SSH FAILED)";
+        else
+            std::cout << target.exit_status;
+        std::cout << "\n";
+
+        if (target.state == 2 && target.exit_status == 0)
+            succeeded++;
+    }
+
+    std::cout << "SUCCEEDED ON " << succeeded << " OF " << targets.size() << " TARGET(S).\n";
+    return succeeded == targets.size();
+}
@@ -1,6 +1,12 @@
 #include "command.hpp"
 #include "util.hpp"
 
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace asyd;
 
 Command& Command::add(const std::string& token, bool add_space)
@@ -58,3 +64,106 @@ const std::string& Command::get_output() const
 {
     return this->command_output;
 }
+
+int Command::get_exit_status() const
+{
+    return this->exit_status;
+}
+
+bool Command::stream(
+    const std::function<bool(const std::string&)>& on_line,
+    const std::atomic<bool>* cancelled)
+{
+    std::string command_str = this->to_string();
+
+    int output_pipe[2];
+    if (pipe2(output_pipe, O_CLOEXEC) != 0)
+        return false;
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        // own process group so stopping kills the whole pipeline (e.g., ssh)
+        setpgid(0, 0);
+
+        // a background process group that reads the terminal gets stopped
+        // (SIGTTIN) and never exits; nothing that's streamed needs input
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd >= 0)
+        {
+            dup2(null_fd, STDIN_FILENO);
+            close(null_fd);
+        }
+
+        dup2(output_pipe[1], STDOUT_FILENO);
+        close(output_pipe[0]);
+        close(output_pipe[1]);
+        execl("/bin/sh", "sh", "-c", command_str.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    // also set here, so the group exists even if it's stopped right away
+    setpgid(pid, pid);
+    close(output_pipe[1]);
+
+    bool stopped = false;
+    std::string pending = "";
+    std::array<char, 4096> buffer;
+
+    while (!stopped)
+    {
+        if (cancelled != nullptr && cancelled->load())
+        {
+            stopped = true;
+            break;
+        }
+
+        // wakes up regularly to notice a cancellation
+        struct pollfd output = { output_pipe[0], POLLIN, 0 };
+        int ready = poll(&output, 1, 100);
+        if (ready == 0)
+            continue;
+        if (ready < 0)
+            break;
+
+        ssize_t bytes_read = read(output_pipe[0], buffer.data(), buffer.size());
+        if (bytes_read <= 0)
+            break;
+
+        pending.append(buffer.data(), bytes_read);
+
+        size_t line_end;
+        while ((line_end = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, line_end);
+            pending.erase(0, line_end + 1);
+
+            if (!on_line(line))
+            {
+                stopped = true;
+                break;
+            }
+        }
+    }
+
+    if (!stopped && pending.length() > 0)
+        on_line(pending);
+
+    if (stopped)
+        kill(-pid, SIGTERM);
+
+    close(output_pipe[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    this->exit_status = !stopped && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    return stopped || this->exit_status == 0;
+}
@@ -1,15 +1,68 @@
 #include "config.hpp"
+#include "builder.hpp"
 #include "server.hpp"
+#include "planner.hpp"
+#include "link.hpp"
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <array>
+#include <fnmatch.h>
 
 using namespace asyd;
 
+// true if [value] is a whole number of at least [minimum]
+static bool is_counter(const std::string& value, int64_t minimum)
+{
+    return value.find_first_not_of("0123456789") == std::string::npos
+        && asyd::util::parse_counter(value) >= minimum;
+}
+
+// the settings whose values set() checks, with what they expect
+static const std::map<std::string, std::pair<std::function<bool(const std::string&)>, std::string>> VALUE_CHECKS = {
+    { "instances", { [](const std::string& value) { return is_counter(value, 1); }, "a number of at least 1" } },
+    { "relay_fanout", { [](const std::string& value) { return is_counter(value, 0); }, "a number (0 to send from the relay to all targets)" } },
+    { "readiness_timeout_sec", { [](const std::string& value) { return asyd::util::parse_positive_int(value) > 0; }, "a positive number of seconds" } },
+    { "overrun_fraction", { [](const std::string& value) { return asyd::util::parse_positive_double(value) > 0; }, "a positive number (e.g., 0.8)" } },
+};
+
+std::string Config::expected_value(const std::string& key)
+{
+    auto check = VALUE_CHECKS.find(key);
+    return check != VALUE_CHECKS.end() ? check->second.second : "";
+}
+
+bool Config::set(const std::string& key, const std::string& value)
+{
+    auto check = VALUE_CHECKS.find(key);
+    std::string stripped_value = asyd::util::strip_newline(value);
+    if (check != VALUE_CHECKS.end() && stripped_value.length() > 0 && !check->second.first(stripped_value))
+        return false;
+
+    if (this->key_action.find(key) != this->key_action.end())
+    {
+        key_action_fptr key_action = this->key_action[key];
+        (this->*key_action)(value);
+        return true;
+    }
+
+    if (Systemd::resource_control_directive(key).length() > 0)
+    {
+        // an empty value removes the setting
+        if (stripped_value.length() > 0)
+            this->resource_controls[key] = stripped_value;
+        else
+            this->resource_controls.erase(key);
+        return true;
+    }
+
+    return false;
+}
+
 bool Config::from_file(const std::string& filepath)
 {
     std::ifstream config(filepath);
@@ -20,13 +73,11 @@ bool Config::from_file(const std::string& filepath)
     while (std::getline(config, current_line))
     {
         auto [key, value] = asyd::util::parse_line(current_line);
-        key_action_fptr key_action = this->key_action[key];
-        if (!key_action)
+        if (!this->set(key, value))
         {
             config.close();
             return false;
         }
-        (this->*key_action)(value);
     }
 
     config.close();
@@ -46,41 +97,275 @@ bool Config::to_file(const std::string& filepath) const
     config << "working_directory=" << this->working_directory << "\n";
     config << "entry_point=" << this->entry_point << "\n";
     config << "schedule=" << this->schedule << "\n";
+    config << "randomized_delay_sec=" << this->randomized_delay_sec << "\n";
+    config << "accuracy_sec=" << this->accuracy_sec << "\n";
+    config << "persistent=" << this->persistent << "\n";
+    config << "overrun_fraction=" << this->overrun_fraction << "\n";
+    config << "listen_stream=" << this->listen_stream << "\n";
+    config << "idle_timeout_sec=" << this->idle_timeout_sec << "\n";
+    config << "readiness=" << this->readiness << "\n";
+    config << "readiness_timeout_sec=" << this->readiness_timeout_sec << "\n";
+    config << "relay_hostname=" << this->relay_hostname << "\n";
+    config << "relay_targets=" << this->relay_targets << "\n";
+    config << "relay_fanout=" << this->relay_fanout << "\n";
+    config << "restart_paths=" << this->restart_paths << "\n";
+    config << "reload_paths=" << this->reload_paths << "\n";
+    config << "ignore_paths=" << this->ignore_paths << "\n";
+    config << "reload_signal=" << this->reload_signal << "\n";
+    config << "instances=" << this->instances << "\n";
+    config << "base_port=" << this->base_port << "\n";
+    config << "pin_instances=" << this->pin_instances << "\n";
+    config << "compression=" << this->compression << "\n";
+    config << "cipher=" << this->cipher << "\n";
+    config << "transfer_streams=" << this->transfer_streams << "\n";
+    config << "transfer_priority=" << this->transfer_priority << "\n";
+    config << "depends_on=" << this->depends_on << "\n";
+    config << "build_command=" << this->build_command << "\n";
+    config << "build_inputs=" << this->build_inputs << "\n";
+    config << "build_output=" << this->build_output << "\n";
     config << "server_home_directory=" << this->server_home_directory << "\n";
     config << "server_bash_directory=" << this->server_bash_directory << "\n";
+    for (const auto& [key, value] : this->resource_controls)
+        config << key << "=" << value << "\n";
     config.close();
     return true;
 }
 
 bool Config::setup_server(const std::string& config_directory)
 {
-    Server server(this->server_hostname);
-
+    Server server;
+    server.set_hostname(this->server_hostname);
     server.set_is_root(this->service_username == "sudo");
-    std::string server_project_dir = server.get_home() + "/.asyd/" + this->project_name;
 
-    if (!server.create_directory("~/.asyd/"))
+    this->tune_transfer(server);
+
+    return this->setup_server(server, config_directory);
+}
+
+bool Config::setup_server(const Server& server, const std::string& config_directory)
+{
+    Builder builder(*this);
+    if (builder.build() == Builder::Outcome::FAILED)
+    {
+        std::cerr << "The build failed (see " << builder.get_log_path() << ").\n";
         return false;
+    }
 
-    if (!server.copy_from_local(this->working_directory, server_project_dir))
+    // only runs the steps that are needed, e.g., when setting up
+    // a project again that already exists on the server
+    Planner planner(*this, server, config_directory);
+    if (!planner.plan())
+    {
+        std::cerr << "Couldn't plan the setup: " << planner.get_error() << ".\n";
         return false;
+    }
 
-    if (!server.chmod("+x", server_project_dir + "/" + this->entry_point))
+    ChangeAction action;
+    if (!planner.execute(action, this->time_to_ready))
         return false;
+    
+    return true;
+}
+
+bool Config::start_service(
+    const Server& server,
+    bool restart,
+    std::chrono::milliseconds& time_to_ready) const
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // jobs are started by their timer, socket-activated servers by their
+    // socket and all other servers directly
+    std::vector<std::string> unit_names = restart ? this->get_restart_units() : this->get_activation_units();
+
+    // one instance at a time so the others keep serving while it restarts
+    for (size_t instance = 0; instance < unit_names.size(); ++instance)
+        if (!this->start_unit(server, restart, unit_names[instance], instance))
+            return false;
 
-    std::string service_name = this->project_name + ".service";
+    time_to_ready = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return true;
+}
 
-    if (!server.copy_systemd_file(config_directory, service_name))
+bool Config::start_unit(
+    const Server& server,
+    bool restart,
+    const std::string& unit_name,
+    int instance) const
+{
+    // with Type=notify systemctl itself blocks until the service is ready
+    if (restart && !server.restart_service(unit_name))
+        return false;
+    else if (!restart && !server.start_service(unit_name))
         return false;
 
-    if (!server.reload_service())
+    std::string probe = this->readiness_probe(instance);
+    if (!this->is_job() && probe.length() > 0
+        && !server.wait_until_ready(probe, this->get_readiness_timeout()))
         return false;
 
-    if (!server.enable_service(service_name))
+    return true;
+}
+
+void Config::tune_transfer(Server& server) const
+{
+    TransferSettings settings;
+
+    // the link only has to be measured if something is left to choose
+    if (this->compression.empty() || this->cipher.empty() || this->transfer_streams.empty())
+    {
+        Link link(this->server_hostname);
+        if (!link.load())
+        {
+            // measured over a persistent connection so the ssh handshake
+            // isn't part of the round trip
+            Server probe = server;
+            bool opened = !probe.is_connected() && probe.open_connection();
+            link.measure(probe);
+            if (opened)
+                probe.close_connection();
+        }
+
+        // without measurements the defaults (plain rsync) are kept
+        if (link.get_throughput() > 0)
+            settings = link.choose();
+    }
+
+    if (this->compression == "none")
+        settings.compression_level = 0;
+    else if (this->compression.length() > 0)
+        settings.compression_level = std::atoi(this->compression.c_str());
+
+    if (this->cipher.length() > 0)
+        settings.ciphers = this->cipher;
+
+    if (this->transfer_streams.length() > 0)
+        settings.streams = std::max(std::atoi(this->transfer_streams.c_str()), 1);
+
+    if (this->transfer_priority == "urgent")
+        settings.priority = BandwidthScheduler::Priority::URGENT;
+    else if (this->transfer_priority == "bulk")
+        settings.priority = BandwidthScheduler::Priority::BULK;
+
+    server.set_transfer_settings(settings);
+}
+
+// true if [path] matches any of the comma-separated [globs]
+static bool matches_any(const std::string& path, const std::string& globs)
+{
+    for (const std::string& glob : asyd::util::split(globs, ','))
+        if (fnmatch(glob.c_str(), path.c_str(), 0) == 0)
+            return true;
+
+    return false;
+}
+
+ChangeAction Config::classify_changes(const std::vector<std::string>& changed_paths) const
+{
+    ChangeAction action = ChangeAction::NONE;
+
+    for (const std::string& path : changed_paths)
+    {
+        ChangeAction path_action = ChangeAction::RESTART;
+
+        if (matches_any(path, this->restart_paths))
+            path_action = ChangeAction::RESTART;
+        else if (matches_any(path, this->reload_paths) && this->reload_signal.length() > 0)
+            path_action = ChangeAction::RELOAD;
+        else if (matches_any(path, this->ignore_paths))
+            path_action = ChangeAction::NONE;
+
+        if (path_action > action)
+            action = path_action;
+
+        if (action == ChangeAction::RESTART)
+            break;
+    }
+
+    return action;
+}
+
+bool Config::apply_changes(
+    const Server& server,
+    const std::vector<std::string>& changed_paths,
+    ChangeAction& action,
+    std::chrono::milliseconds& time_to_ready) const
+{
+    action = this->is_job() ? ChangeAction::NONE : this->classify_changes(changed_paths);
+    time_to_ready = std::chrono::milliseconds(0);
+
+    if (action == ChangeAction::RESTART)
+        return this->start_service(server, true, time_to_ready);
+
+    // try-reload-or-restart leaves a service that isn't running alone
+    // (e.g., an idle socket-activated one)
+    if (action == ChangeAction::RELOAD)
+    {
+        for (const std::string& unit_name : this->get_restart_units())
+            if (!server.reload_unit(unit_name))
+                return false;
+    }
+
+    return true;
+}
+
+std::string Config::readiness_probe(int instance) const
+{
+    // the socket of a socket-activated server accepts connections before
+    // the service even started, so there's nothing to wait for
+    if (this->readiness.rfind("tcp:", 0) == 0 && this->is_socket_activated())
+        return "";
+
+    if (this->readiness.rfind("tcp:", 0) == 0)
+    {
+        std::string address = this->readiness.substr(4);
+        std::string host = "127.0.0.1";
+        std::string port = address;
+
+        size_t separator = address.rfind(':');
+        if (separator != std::string::npos)
+        {
+            host = address.substr(0, separator);
+            port = address.substr(separator + 1);
+        }
+
+        if (this->is_templated())
+            port = std::to_string(std::atoi(port.c_str()) + instance);
+
+        return "(exec 3<>/dev/tcp/" + host + "/" + port + ") 2>/dev/null";
+    }
+
+    if (this->readiness.rfind("http://", 0) == 0 || this->readiness.rfind("https://", 0) == 0)
+        return "curl -fs -o /dev/null --max-time 2 " + asyd::util::shell_quote(this->readiness);
+
+    // "notify" is handled by systemd itself (see Systemd::to_file())
+    return "";
+}
+
+bool Config::write_systemd_files(const std::string& config_directory) const
+{
+    Systemd service;
+    service.from_config(*this);
+
+    if (!service.to_file(config_directory + "/" + this->get_service_file()))
         return false;
 
-    if (!server.start_service(service_name))
+    if (this->is_job() && !service.to_timer_file(config_directory + "/" + this->project_name + ".timer"))
         return false;
-    
+
+    if (this->is_socket_activated() && !service.to_socket_file(config_directory + "/" + this->project_name + ".socket"))
+        return false;
+
+    return true;
+}
+
+bool Config::copy_systemd_files(const Server& server, const std::string& config_directory) const
+{
+    for (const std::string& systemd_file : this->get_systemd_files())
+        if (!server.copy_systemd_file(config_directory, systemd_file))
+            return false;
+
     return true;
 }
@@ -0,0 +1,206 @@
+#include "job_history.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <sstream>
+
+using namespace asyd;
+
+// the service manager's messages about a oneshot run, in order
+static const std::string RUN_STARTING = "7d4958e842da4a758f6c1cdc7b36dcc5";
+static const std::string PROCESS_EXITED = "98e322203f7a4ed290d09fe03c09fe15";
+static const std::string RUN_FINISHED = "39f53479d3a045ac8e11786248231fbf";
+static const std::string RUN_FAILED = "be02cf6855d2428ba40df7e9d022f03d";
+static const std::string RESOURCES_USED = "ae8f7b866b0347b9af31fe1c80b127c0";
+
+static const char* FIELDS = "MESSAGE_ID,EXIT_CODE,EXIT_STATUS,CPU_USAGE_NSEC,MEMORY_PEAK,IO_READ_BYTES,IO_WRITE_BYTES";
+
+// seconds since the epoch of the "YYYY-MM-DD HH:MM:SS" in a line of
+// systemd-analyze calendar, -1 if there is none (only differences between
+// two of them are used, so the time zone doesn't matter)
+static int64_t parse_elapse(const std::string& line)
+{
+    std::istringstream tokens(line);
+    std::string token;
+    while (tokens >> token)
+    {
+        std::tm time = {};
+        if (token.length() != 10 || std::sscanf(token.c_str(), "%d-%d-%d", &time.tm_year, &time.tm_mon, &time.tm_mday) != 3)
+            continue;
+
+        if (!(tokens >> token) || std::sscanf(token.c_str(), "%d:%d:%d", &time.tm_hour, &time.tm_min, &time.tm_sec) != 3)
+            return -1;
+
+        time.tm_year -= 1900;
+        time.tm_mon -= 1;
+        return static_cast<int64_t>(timegm(&time));
+    }
+
+    return -1;
+}
+
+JobHistory::JobHistory(const std::string& service_name, const std::string& schedule)
+    : service_name(service_name), schedule(schedule)
+{
+}
+
+bool JobHistory::fetch(const Server& server, size_t max_runs)
+{
+    std::vector<std::string> message_ids = { RUN_STARTING, PROCESS_EXITED, RUN_FINISHED, RUN_FAILED, RESOURCES_USED };
+
+    // one message of each kind per run, plus the rest of a run cut off
+    // at the beginning
+    std::string output;
+    if (!server.fetch_job_history(this->service_name, message_ids, FIELDS, this->schedule,
+            static_cast<int>((max_runs + 1) * message_ids.size()), output))
+        return false;
+
+    this->parse(output, max_runs);
+    return true;
+}
+
+void JobHistory::parse(const std::string& output, size_t max_runs)
+{
+    std::vector<std::map<std::string, std::string>> entries(1);
+    std::map<std::string, std::string> unit;
+    int64_t next_elapse = -1;
+    int64_t second_elapse = -1;
+
+    std::istringstream lines(output);
+    std::string line;
+    std::string section = "journal";
+    while (std::getline(lines, line))
+    {
+        if (line.rfind("@@", 0) == 0)
+            section = line.substr(2);
+        else if (section == "journal")
+        {
+            // the export format separates entries with an empty line
+            if (line.empty())
+                entries.emplace_back();
+            else
+                entries.back().insert(asyd::util::parse_line(line));
+        }
+        else if (section == "unit")
+            unit.insert(asyd::util::parse_line(line));
+        else if (section == "schedule" && line.find("Next elapse:") != std::string::npos)
+            next_elapse = parse_elapse(line);
+        else if (section == "schedule" && line.find("Iter. #2:") != std::string::npos)
+            second_elapse = parse_elapse(line);
+        else if (section == "now")
+            this->now_us = asyd::util::parse_counter(line) * 1000000;
+    }
+
+    this->runs.clear();
+    for (std::map<std::string, std::string>& entry : entries)
+    {
+        const std::string& message_id = entry["MESSAGE_ID"];
+        if (message_id == RUN_STARTING)
+        {
+            Run run;
+            run.started_us = asyd::util::parse_counter(entry["__REALTIME_TIMESTAMP"]);
+            this->runs.push_back(run);
+            continue;
+        }
+
+        // the rest of a run whose start was cut off
+        if (this->runs.empty())
+            continue;
+
+        Run& run = this->runs.back();
+        if (message_id == PROCESS_EXITED)
+        {
+            run.exit_code = entry["EXIT_CODE"];
+            if (run.exit_code == "exited")
+                run.exit_status = std::atoi(entry["EXIT_STATUS"].c_str());
+        }
+        else if (message_id == RUN_FINISHED || message_id == RUN_FAILED)
+        {
+            run.finished_us = asyd::util::parse_counter(entry["__REALTIME_TIMESTAMP"]);
+            run.succeeded = message_id == RUN_FINISHED;
+        }
+        else if (message_id == RESOURCES_USED)
+        {
+            run.cpu_usage_nsec = asyd::util::parse_counter(entry["CPU_USAGE_NSEC"]);
+            run.memory_peak_bytes = asyd::util::parse_counter(entry["MEMORY_PEAK"]);
+            run.io_read_bytes = asyd::util::parse_counter(entry["IO_READ_BYTES"]);
+            run.io_write_bytes = asyd::util::parse_counter(entry["IO_WRITE_BYTES"]);
+        }
+    }
+
+    // a oneshot service is "activating" while it runs; a run without an end
+    // that isn't running anymore lost its end (e.g., a rotated journal)
+    if (!this->runs.empty() && this->runs.back().is_running())
+    {
+        if (unit["ActiveState"] == "activating")
+        {
+            this->runs.back().cpu_usage_nsec = asyd::util::parse_counter(unit["CPUUsageNSec"]);
+            this->runs.back().memory_peak_bytes = asyd::util::parse_counter(unit["MemoryCurrent"]);
+        }
+        else
+            this->runs.pop_back();
+    }
+
+    if (this->runs.size() > max_runs)
+        this->runs.erase(this->runs.begin(), this->runs.end() - max_runs);
+
+    // schedules systemd can't evaluate (e.g., older versions without
+    // --iterations) fall back to the observed interval
+    this->interval_sec = 0;
+    if (next_elapse > 0 && second_elapse > next_elapse)
+        this->interval_sec = second_elapse - next_elapse;
+    else if (this->runs.size() >= 2)
+    {
+        std::vector<int64_t> gaps;
+        for (size_t i = 1; i < this->runs.size(); ++i)
+            gaps.push_back((this->runs[i].started_us - this->runs[i - 1].started_us) / 1000000);
+
+        std::sort(gaps.begin(), gaps.end());
+        this->interval_sec = gaps[gaps.size() / 2];
+    }
+}
+
+const std::vector<JobHistory::Run>& JobHistory::get_runs() const
+{
+    return this->runs;
+}
+
+int64_t JobHistory::get_interval_sec() const
+{
+    return this->interval_sec;
+}
+
+double JobHistory::get_duration_sec(const Run& run) const
+{
+    int64_t finished_us = run.is_running() ? this->now_us : run.finished_us;
+    return std::max<int64_t>(finished_us - run.started_us, 0) / 1e6;
+}
+
+double JobHistory::get_duration_percentile(double percentile) const
+{
+    std::vector<double> durations;
+    for (const Run& run : this->runs)
+        if (!run.is_running())
+            durations.push_back(this->get_duration_sec(run));
+
+    if (durations.empty())
+        return -1;
+
+    // nearest rank
+    std::sort(durations.begin(), durations.end());
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * durations.size()));
+    return durations[std::min(std::max<size_t>(rank, 1), durations.size()) - 1];
+}
+
+bool JobHistory::is_overrun(const Run& run, double fraction) const
+{
+    if (this->interval_sec <= 0)
+        return false;
+
+    return this->get_duration_sec(run) > fraction * this->interval_sec;
+}
@@ -0,0 +1,727 @@
+#include "libasyd.hpp"
+#include "builder.hpp"
+#include "config.hpp"
+#include "planner.hpp"
+#include "relay.hpp"
+#include "server.hpp"
+#include "status_cache.hpp"
+
+#include <filesystem>
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <fnmatch.h>
+
+using namespace asyd;
+
+struct Project::Impl
+{
+    Config config;
+    Server server;
+    bool loaded = false;
+};
+
+Project::Project() : impl(new Impl()) {}
+
+Project::Project(const Project& other) : impl(new Impl(*other.impl)) {}
+
+Project& Project::operator=(const Project& other)
+{
+    if (this != &other)
+        this->impl.reset(new Impl(*other.impl));
+    return *this;
+}
+
+Project::~Project() {}
+
+Result Project::load(const std::string& project_name)
+{
+    Result result;
+
+    std::string project_dir = asyd::util::get_asyd_project_dir(project_name);
+    if (!std::filesystem::exists(project_dir))
+    {
+        Project::fail(result, ErrorCode::PROJECT_NOT_FOUND, "project '" + project_name + "' doesn't exist");
+        return result;
+    }
+
+    this->impl->config = Config();
+    if (!this->impl->config.from_file(project_dir + "config.cfg"))
+    {
+        Project::fail(result, ErrorCode::INVALID_CONFIG, "couldn't read config of project '" + project_name + "'");
+        return result;
+    }
+
+    // the server info was fetched when the project was created, so no
+    // connection is needed here
+    this->impl->server = Server();
+    this->impl->server.set_hostname(this->impl->config.get_server_hostname());
+    this->impl->server.set_is_root(this->impl->config.get_service_username() == "sudo");
+
+    this->impl->loaded = true;
+    return result;
+}
+
+Result Project::deploy() const
+{
+    return this->run(&Project::run_deploy);
+}
+
+Result Project::stage() const
+{
+    return this->run(&Project::run_stage);
+}
+
+Result Project::activate() const
+{
+    return this->run(&Project::run_activate);
+}
+
+Result Project::plan() const
+{
+    return this->run(&Project::run_plan);
+}
+
+Result Project::start() const
+{
+    return this->run(&Project::run_start);
+}
+
+Result Project::stop() const
+{
+    return this->run(&Project::run_stop);
+}
+
+Result Project::restart() const
+{
+    return this->run(&Project::run_restart);
+}
+
+Result Project::status() const
+{
+    return this->run(&Project::run_status);
+}
+
+bool Project::set_setting(const std::string& key, const std::string& value)
+{
+    return this->impl->config.set(key, value);
+}
+
+const std::string& Project::get_hostname() const
+{
+    return this->impl->config.get_server_hostname();
+}
+
+std::vector<std::string> Project::get_depends_on() const
+{
+    return this->impl->config.get_depends_on();
+}
+
+bool Project::is_job() const
+{
+    return this->impl->config.is_job();
+}
+
+std::future<Result> Project::deploy_async() const
+{
+    return std::async(std::launch::async, [this]() { return this->deploy(); });
+}
+
+std::future<Result> Project::restart_async() const
+{
+    return std::async(std::launch::async, &Project::restart, this);
+}
+
+// drops the cached status of the project and the service list of its host
+// (see CLI::status()) after an action on the service
+static void invalidate_status(const Config& config)
+{
+    StatusCache("status-" + config.get_project_name()).invalidate();
+    StatusCache("ls-" + config.get_server_hostname()).invalidate();
+}
+
+Result Project::run(operation_fptr operation) const
+{
+    Result result;
+    if (!this->impl->loaded)
+    {
+        Project::fail(result, ErrorCode::NOT_LOADED, "project wasn't loaded");
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    (this->*operation)(result);
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    // also after a failed action, it may have changed the service anyway
+    if (operation != &Project::run_status && operation != &Project::run_plan)
+        invalidate_status(this->impl->config);
+
+    return result;
+}
+
+Result Project::deploy(const std::function<bool()>& before_activation) const
+{
+    Result result;
+    if (!this->impl->loaded)
+    {
+        Project::fail(result, ErrorCode::NOT_LOADED, "project wasn't loaded");
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    this->run_staged_deploy(result, before_activation);
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    invalidate_status(this->impl->config);
+
+    return result;
+}
+
+bool Project::run_deploy(Result& result) const
+{
+    return this->run_staged_deploy(result, nullptr);
+}
+
+// projects pulled from a server (see CLI::pull()) have no working
+// directory until it's set, there's nothing to deploy from before that
+static std::string missing_working_directory(const Config& config)
+{
+    return "no working_directory set in " + asyd::util::get_asyd_project_dir(config.get_project_name()) + "config.cfg";
+}
+
+// of a failed Planner::plan()
+static ErrorCode plan_error_code(const Planner& planner)
+{
+    return planner.is_scan_error() ? ErrorCode::SCAN_FAILED : ErrorCode::CONNECTION_FAILED;
+}
+
+// local list of what a deploy copied but didn't activate (its
+// before_activation failed), "@@systemd" for changed systemd files
+static std::string pending_activation_path(const Config& config)
+{
+    return asyd::util::get_asyd_project_dir(config.get_project_name()) + "pending";
+}
+
+// adds the copied files (and whether systemd files changed) of [planner]
+// to the pending activation, a later deploy won't see them as changes
+static void add_pending_activation(const Config& config, const Planner& planner)
+{
+    std::ofstream pending(pending_activation_path(config), std::ios::app);
+    if (planner.has_changed_systemd_files())
+        pending << "@@systemd\n";
+    for (const std::string& path : planner.get_copied_files())
+        pending << path << "\n";
+}
+
+// false if there's no pending activation
+static bool read_pending_activation(const Config& config, std::vector<std::string>& paths, bool& systemd_files_changed)
+{
+    std::ifstream pending(pending_activation_path(config));
+    if (!pending.is_open())
+        return false;
+
+    paths.clear();
+    systemd_files_changed = false;
+    for (std::string path; std::getline(pending, path);)
+    {
+        if (path == "@@systemd")
+            systemd_files_changed = true;
+        else
+            paths.push_back(path);
+    }
+
+    return true;
+}
+
+bool Project::run_staged_deploy(Result& result, const std::function<bool()>& before_activation) const
+{
+    if (this->impl->config.get_working_directory().empty())
+        return Project::fail(result, ErrorCode::INVALID_CONFIG, missing_working_directory(this->impl->config));
+
+    // skipped if the output was already built from the current inputs
+    Builder builder(this->impl->config);
+    result.build_outcome = builder.build();
+    if (result.build_outcome == BuildOutcome::FAILED)
+        return Project::fail(result, ErrorCode::BUILD_FAILED, "the build failed (see " + builder.get_log_path() + ")");
+
+    if (this->impl->config.get_relay_hostname().length() > 0)
+    {
+        if (before_activation && !before_activation())
+            return Project::fail(result, ErrorCode::DEPENDENCY_FAILED, "a project it depends on failed");
+
+        return this->run_relay_deploy(result);
+    }
+
+    Server server = this->impl->server;
+    this->impl->config.tune_transfer(server);
+
+    Planner planner(this->impl->config, server, asyd::util::get_asyd_project_dir(this->impl->config.get_project_name()));
+    if (!planner.plan())
+        return Project::fail(result, plan_error_code(planner), planner.get_error());
+
+    // copies what changed and updates systemd files if needed
+    if (!planner.transfer())
+        return Project::fail(result, ErrorCode::TRANSFER_FAILED, "couldn't copy the files to '" + this->impl->config.get_server_hostname() + "'");
+
+    if (before_activation && !before_activation())
+    {
+        add_pending_activation(this->impl->config, planner);
+        return Project::fail(result, ErrorCode::DEPENDENCY_FAILED, "a project it depends on failed");
+    }
+
+    // what an earlier deploy copied without activating it
+    std::vector<std::string> pending_paths;
+    bool pending_systemd_files = false;
+    bool pending = read_pending_activation(this->impl->config, pending_paths, pending_systemd_files);
+    if (pending_systemd_files && !server.reload_service())
+        return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't reload systemd on '" + this->impl->config.get_server_hostname() + "'");
+
+    // restarts, reloads or leaves the service alone depending on what changed
+    if (!planner.activate(result.change_action, result.time_to_ready))
+        return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't deploy to '" + this->impl->config.get_server_hostname() + "'");
+
+    // a restart for this deploy's own changes covers the pending ones
+    if (pending && result.change_action != ChangeAction::RESTART && !this->impl->config.is_job())
+    {
+        ChangeAction pending_action = ChangeAction::RESTART;
+        std::chrono::milliseconds time_to_ready(0);
+        bool applied = pending_systemd_files
+            ? this->impl->config.start_service(server, true, time_to_ready)
+            : this->impl->config.apply_changes(server, pending_paths, pending_action, time_to_ready);
+        if (!applied)
+            return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't apply the pending changes on '" + this->impl->config.get_server_hostname() + "'");
+
+        result.change_action = std::max(result.change_action, pending_action);
+        result.time_to_ready = std::max(result.time_to_ready, time_to_ready);
+    }
+
+    if (pending)
+        std::filesystem::remove(pending_activation_path(this->impl->config));
+
+    return true;
+}
+
+bool Project::run_plan(Result& result) const
+{
+    Planner planner(this->impl->config, this->impl->server, asyd::util::get_asyd_project_dir(this->impl->config.get_project_name()));
+    if (!planner.plan())
+        return Project::fail(result, plan_error_code(planner), planner.get_error());
+
+    for (const Planner::Step& step : planner.get_steps())
+        result.output += (result.output.empty() ? "" : "\n") + planner.describe(step);
+
+    return true;
+}
+
+// staging directory on the server and the previous version
+static std::string staging_path(const Config& config)
+{
+    return config.get_server_home_directory() + "/.asyd/" + config.get_project_name() + ".next";
+}
+
+static std::string previous_path(const Config& config)
+{
+    return config.get_server_home_directory() + "/.asyd/" + config.get_project_name() + ".prev";
+}
+
+bool Project::run_stage(Result& result) const
+{
+    if (this->impl->config.get_relay_hostname().length() > 0)
+        return Project::fail(result, ErrorCode::INVALID_CONFIG, "relay projects can't be staged");
+
+    if (this->impl->config.get_working_directory().empty())
+        return Project::fail(result, ErrorCode::INVALID_CONFIG, missing_working_directory(this->impl->config));
+
+    Builder builder(this->impl->config);
+    result.build_outcome = builder.build();
+    if (result.build_outcome == BuildOutcome::FAILED)
+        return Project::fail(result, ErrorCode::BUILD_FAILED, "the build failed (see " + builder.get_log_path() + ")");
+
+    Server server = this->impl->server;
+    this->impl->config.tune_transfer(server);
+
+    std::string project_dir = asyd::util::get_asyd_project_dir(this->impl->config.get_project_name());
+    std::string server_project_dir = this->impl->config.get_server_home_directory() + "/.asyd/" + this->impl->config.get_project_name();
+
+    // starts out empty; unchanged files are hard linked from the running
+    // version by rsync, so only what changed is copied
+    if (!server.prepare_staging_directory(staging_path(this->impl->config), previous_path(this->impl->config)))
+        return Project::fail(result, ErrorCode::CONNECTION_FAILED, "couldn't prepare the staging directory on '" + this->impl->config.get_server_hostname() + "'");
+    server.set_link_dest(server_project_dir);
+
+    Planner planner(this->impl->config, server, project_dir);
+    planner.set_server_project_dir(staging_path(this->impl->config));
+    if (!planner.plan())
+        return Project::fail(result, plan_error_code(planner), planner.get_error());
+
+    if (!planner.transfer_files())
+        return Project::fail(result, ErrorCode::TRANSFER_FAILED, "couldn't copy the files to '" + this->impl->config.get_server_hostname() + "'");
+
+    // planned again, the staged files have to match the local ones now
+    Planner verification(this->impl->config, server, project_dir);
+    verification.set_server_project_dir(staging_path(this->impl->config));
+    if (!verification.plan())
+        return Project::fail(result, plan_error_code(verification), verification.get_error());
+    if (verification.has_changed_files())
+        return Project::fail(result, ErrorCode::TRANSFER_FAILED, "the staged files on '" + this->impl->config.get_server_hostname() + "' don't match the local ones");
+
+    result.output = std::to_string(planner.get_copied_files().size()) + " changed file(s) staged";
+    return true;
+}
+
+bool Project::run_activate(Result& result) const
+{
+    if (this->impl->config.get_relay_hostname().length() > 0)
+        return Project::fail(result, ErrorCode::INVALID_CONFIG, "relay projects can't be staged");
+
+    std::string server_project_dir = this->impl->config.get_server_home_directory() + "/.asyd/" + this->impl->config.get_project_name();
+    if (!this->impl->server.activate_staging_directory(server_project_dir, staging_path(this->impl->config), previous_path(this->impl->config)))
+        return Project::fail(result, ErrorCode::NOTHING_STAGED, "nothing staged on '" + this->impl->config.get_server_hostname() + "' (run stage first)");
+
+    // the project's files aren't copied again, only changed systemd files
+    Planner planner(this->impl->config, this->impl->server, asyd::util::get_asyd_project_dir(this->impl->config.get_project_name()));
+    if (!planner.plan())
+        return Project::fail(result, plan_error_code(planner), planner.get_error());
+    if (!planner.transfer_systemd_files())
+        return Project::fail(result, ErrorCode::CONNECTION_FAILED, "couldn't update the systemd files on '" + this->impl->config.get_server_hostname() + "'");
+
+    if (!planner.activate(result.change_action, result.time_to_ready))
+        return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't activate on '" + this->impl->config.get_server_hostname() + "'");
+
+    // the running process still uses the files of the moved away version
+    // (which the next stage removes), so a reload or nothing isn't enough;
+    // a job's next run starts from the new version anyway
+    if (result.change_action != ChangeAction::RESTART && !this->impl->config.is_job())
+    {
+        if (!this->impl->config.start_service(this->impl->server, true, result.time_to_ready))
+            return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't restart service '" + this->impl->config.get_project_name() + "'");
+        result.change_action = ChangeAction::RESTART;
+    }
+
+    return true;
+}
+
+bool Project::run_relay_deploy(Result& result) const
+{
+    Relay relay(this->impl->config);
+    if (!relay.deploy(result.target_results))
+        return Project::fail(result, ErrorCode::TRANSFER_FAILED, "couldn't copy files to relay '" + this->impl->config.get_relay_hostname() + "'");
+
+    size_t failed_targets = 0;
+    for (const TargetResult& target_result : result.target_results)
+    {
+        if (!target_result.success)
+            failed_targets++;
+        else if (target_result.time_to_ready > result.time_to_ready)
+            result.time_to_ready = target_result.time_to_ready;
+    }
+
+    if (failed_targets > 0)
+        return Project::fail(result, ErrorCode::TARGETS_FAILED, std::to_string(failed_targets) + " of "
+            + std::to_string(result.target_results.size()) + " targets failed");
+
+    return true;
+}
+
+bool Project::run_start(Result& result) const
+{
+    if (!this->impl->config.start_service(this->impl->server, false, result.time_to_ready))
+        return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't start service '" + this->impl->config.get_project_name() + "'");
+
+    return true;
+}
+
+bool Project::run_stop(Result& result) const
+{
+    for (const std::string& unit_name : this->impl->config.get_activation_units())
+        if (!this->impl->server.stop_service(unit_name))
+            return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't stop service '" + this->impl->config.get_project_name() + "'");
+
+    return true;
+}
+
+bool Project::run_restart(Result& result) const
+{
+    if (!this->impl->config.start_service(this->impl->server, true, result.time_to_ready))
+        return Project::fail(result, ErrorCode::SERVICE_ACTION_FAILED, "couldn't restart service '" + this->impl->config.get_project_name() + "'");
+
+    return true;
+}
+
+bool Project::run_status(Result& result) const
+{
+    if (!this->impl->server.check_status(this->impl->config.get_status_unit(), result.output))
+        return Project::fail(result, ErrorCode::STATUS_FAILED, "couldn't check status for service '" + this->impl->config.get_project_name() + "'");
+
+    return true;
+}
+
+bool Project::fail(Result& result, ErrorCode error_code, const std::string& message)
+{
+    result.error_code = error_code;
+    result.message = message;
+    return false;
+}
+
+std::vector<std::string> asyd::find_projects(const std::vector<std::string>& patterns)
+{
+    std::vector<std::string> project_names;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(asyd::util::get_asyd_dir(), error))
+    {
+        std::string name = entry.path().filename().string();
+
+        // directories starting with a dot are asyd's own (caches etc.)
+        if (!entry.is_directory() || name[0] == '.')
+            continue;
+
+        for (const std::string& pattern : patterns)
+        {
+            if (fnmatch(pattern.c_str(), name.c_str(), 0) == 0)
+            {
+                project_names.push_back(name);
+                break;
+            }
+        }
+    }
+
+    std::sort(project_names.begin(), project_names.end());
+    return project_names;
+}
+
+Result asyd::service_action(const std::vector<std::string>& patterns, const std::string& action)
+{
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> project_names = asyd::find_projects(patterns);
+    if (project_names.empty())
+    {
+        result.error_code = ErrorCode::PROJECT_NOT_FOUND;
+        result.message = "no matching projects";
+        return result;
+    }
+
+    // units are grouped by host and whether they are system or user units
+    // since those need different systemctl calls
+    struct HostUnits
+    {
+        Server server;
+        std::vector<std::string> project_names;
+        std::vector<std::string> unit_names;
+    };
+    std::map<std::pair<std::string, bool>, HostUnits> hosts;
+
+    for (const std::string& project_name : project_names)
+    {
+        Config config;
+        if (!config.from_file(asyd::util::get_asyd_project_dir(project_name) + "config.cfg"))
+        {
+            TargetResult target_result;
+            target_result.project_name = project_name;
+            target_result.message = "couldn't read config";
+            result.target_results.push_back(target_result);
+            continue;
+        }
+
+        bool is_root = config.get_service_username() == "sudo";
+        HostUnits& host = hosts[{ config.get_server_hostname(), is_root }];
+        host.server.set_hostname(config.get_server_hostname());
+        host.server.set_is_root(is_root);
+
+        // instances are reported separately, e.g., "api@0"
+        for (const std::string& unit_name : action == "restart" ? config.get_restart_units() : config.get_activation_units())
+        {
+            host.project_names.push_back(config.is_templated() ? unit_name.substr(0, unit_name.rfind('.')) : project_name);
+            host.unit_names.push_back(unit_name);
+        }
+    }
+
+    std::vector<std::future<std::vector<TargetResult>>> host_actions;
+    for (auto& [key, host] : hosts)
+    {
+        host_actions.push_back(std::async(std::launch::async, [&action, &host]() {
+            std::vector<std::string> states;
+            bool reached = host.server.bulk_action(action, host.unit_names, states);
+
+            std::vector<TargetResult> target_results;
+            for (size_t i = 0; i < host.unit_names.size(); ++i)
+            {
+                TargetResult target_result;
+                target_result.hostname = host.server.get_hostname();
+                target_result.project_name = host.project_names[i];
+
+                if (!reached)
+                    target_result.message = "couldn't reach server";
+                else if (action == "stop")
+                    target_result.success = states[i] == "inactive";
+                else
+                    target_result.success = states[i] == "active" || states[i] == "activating";
+
+                if (reached)
+                    target_result.message = states[i];
+
+                target_results.push_back(target_result);
+            }
+
+            return target_results;
+        }));
+    }
+
+    for (auto& host_action : host_actions)
+    {
+        std::vector<TargetResult> target_results = host_action.get();
+        result.target_results.insert(result.target_results.end(), target_results.begin(), target_results.end());
+    }
+
+    // see invalidate_status()
+    for (const std::string& project_name : project_names)
+        StatusCache("status-" + project_name).invalidate();
+    for (const auto& [key, host] : hosts)
+        StatusCache("ls-" + key.first).invalidate();
+
+    size_t failed_units = 0;
+    for (const TargetResult& target_result : result.target_results)
+        if (!target_result.success)
+            failed_units++;
+
+    if (failed_units > 0)
+    {
+        result.error_code = ErrorCode::TARGETS_FAILED;
+        result.message = std::to_string(failed_units) + " of " + std::to_string(result.target_results.size()) + " units failed";
+    }
+
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return result;
+}
+
+Result asyd::deploy_projects(const std::vector<std::string>& patterns)
+{
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> project_names = asyd::find_projects(patterns);
+    if (project_names.empty())
+    {
+        result.error_code = ErrorCode::PROJECT_NOT_FOUND;
+        result.message = "no matching projects";
+        return result;
+    }
+
+    std::vector<Project> projects(project_names.size());
+    std::map<std::string, size_t> indices;
+    for (size_t i = 0; i < project_names.size(); ++i)
+    {
+        Result loaded = projects[i].load(project_names[i]);
+        if (!loaded.ok())
+        {
+            result.error_code = loaded.error_code;
+            result.message = "'" + project_names[i] + "': " + loaded.message;
+            return result;
+        }
+
+        indices[project_names[i]] = i;
+    }
+
+    // the dependencies among the deployed projects
+    std::vector<std::vector<size_t>> dependencies(projects.size());
+    for (size_t i = 0; i < projects.size(); ++i)
+        for (const std::string& dependency : projects[i].get_depends_on())
+            if (indices.count(dependency) > 0 && indices[dependency] != i)
+                dependencies[i].push_back(indices[dependency]);
+
+    // a cycle would wait forever
+    std::vector<size_t> order;
+    if (!asyd::util::order_dependencies(dependencies, order))
+    {
+        std::string cycle = "";
+        for (size_t i = 0; i < projects.size(); ++i)
+            if (std::find(order.begin(), order.end(), i) == order.end())
+                cycle += (cycle.empty() ? "" : ", ") + project_names[i];
+
+        result.error_code = ErrorCode::INVALID_CONFIG;
+        result.message = "circular depends_on between " + cycle;
+        return result;
+    }
+
+    enum class State { PENDING, ACTIVATED, FAILED };
+    std::vector<State> states(projects.size(), State::PENDING);
+    std::mutex mutex;
+    std::condition_variable states_changed;
+
+    std::vector<TargetResult> target_results;
+
+    std::vector<std::future<void>> deploys;
+    for (size_t i = 0; i < projects.size(); ++i)
+    {
+        deploys.push_back(std::async(std::launch::async, [&, i]() {
+            std::string failed_dependency = "";
+
+            Result project_result = projects[i].deploy([&]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                states_changed.wait(lock, [&]() {
+                    return std::none_of(dependencies[i].begin(), dependencies[i].end(), [&](size_t dependency) {
+                        return states[dependency] == State::PENDING;
+                    });
+                });
+
+                for (size_t dependency : dependencies[i])
+                    if (states[dependency] == State::FAILED)
+                        failed_dependency = project_names[dependency];
+
+                return failed_dependency.empty();
+            });
+
+            TargetResult target_result;
+            target_result.project_name = project_names[i];
+            target_result.hostname = projects[i].get_hostname();
+            target_result.success = project_result.ok();
+            target_result.time_to_ready = project_result.time_to_ready;
+
+            if (project_result.error_code == ErrorCode::DEPENDENCY_FAILED)
+                target_result.message = "not activated since '" + failed_dependency + "' failed";
+            else if (!project_result.ok())
+                target_result.message = project_result.message;
+            else if (project_result.change_action == ChangeAction::NONE)
+                target_result.message = "no restart needed";
+            else if (project_result.change_action == ChangeAction::RELOAD)
+                target_result.message = "reloaded";
+            else
+                target_result.message = "ready after " + std::to_string(project_result.time_to_ready.count()) + " ms";
+
+            std::lock_guard<std::mutex> lock(mutex);
+            states[i] = project_result.ok() ? State::ACTIVATED : State::FAILED;
+            target_results.push_back(target_result);
+            states_changed.notify_all();
+        }));
+    }
+
+    for (auto& deploy : deploys)
+        deploy.get();
+
+    result.target_results = target_results;
+
+    size_t failed_projects = 0;
+    for (const TargetResult& target_result : result.target_results)
+        if (!target_result.success)
+            failed_projects++;
+
+    if (failed_projects > 0)
+    {
+        result.error_code = ErrorCode::TARGETS_FAILED;
+        result.message = std::to_string(failed_projects) + " of " + std::to_string(result.target_results.size()) + " projects failed";
+    }
+
+    result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return result;
+}
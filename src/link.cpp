@@ -0,0 +1,133 @@
+#include "link.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace asyd;
+
+// first probe of the upload throughput, a bigger one follows on fast links
+static const size_t SMALL_PROBE_BYTES = 256 * 1024;
+static const size_t LARGE_PROBE_BYTES = 8 * 1024 * 1024;
+
+static const double MEGABYTE = 1024 * 1024;
+
+// true if this machine's CPU has AES instructions, which makes AES-GCM
+// the fastest cipher; otherwise ChaCha20 is
+static bool has_aes_instructions()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    if (!cpuinfo.is_open())
+        return true;
+
+    // "flags" on x86, "Features" on ARM
+    std::string line;
+    while (std::getline(cpuinfo, line))
+        if (line.rfind("flags", 0) == 0 || line.rfind("Features", 0) == 0)
+            return (line + " ").find(" aes ") != std::string::npos;
+
+    return true;
+}
+
+Link::Link(const std::string& hostname)
+{
+    this->hostname = hostname;
+}
+
+std::string Link::cache_path() const
+{
+    return asyd::util::get_asyd_dir() + ".hosts/" + this->hostname;
+}
+
+bool Link::load()
+{
+    std::ifstream cache(this->cache_path());
+    if (!cache.is_open())
+        return false;
+
+    std::string line;
+    while (std::getline(cache, line))
+    {
+        auto [key, value] = asyd::util::parse_line(line);
+        if (key == "round_trip_us")
+            this->round_trip = std::chrono::microseconds(std::atoll(value.c_str()));
+        else if (key == "throughput")
+            this->throughput = std::atof(value.c_str());
+        else if (key == "measured_at")
+            this->measured_at = std::atoll(value.c_str());
+    }
+
+    return this->throughput > 0 && std::time(nullptr) - this->measured_at < Link::MAX_AGE_SEC;
+}
+
+bool Link::save() const
+{
+    std::error_code error;
+    std::filesystem::create_directories(asyd::util::get_asyd_dir() + ".hosts", error);
+
+    std::ofstream cache(this->cache_path());
+    if (!cache.is_open())
+        return false;
+
+    cache << "round_trip_us=" << this->round_trip.count() << "\n";
+    cache << "throughput=" << static_cast<long long>(this->throughput) << "\n";
+    cache << "measured_at=" << this->measured_at << "\n";
+    cache.close();
+    return true;
+}
+
+bool Link::measure(const Server& server)
+{
+    if (!server.measure_round_trip(3, this->round_trip))
+        return false;
+
+    // the small probe keeps measuring slow links short; if it was over
+    // quickly it's dominated by the round trip, so a bigger one follows
+    size_t bytes = SMALL_PROBE_BYTES;
+    std::chrono::microseconds duration;
+    if (!server.measure_upload(bytes, duration))
+        return false;
+
+    if (duration - this->round_trip < std::chrono::milliseconds(200))
+    {
+        bytes = LARGE_PROBE_BYTES;
+        if (!server.measure_upload(bytes, duration))
+            return false;
+    }
+
+    auto transfer_time = std::max<std::chrono::microseconds>(duration - this->round_trip, std::chrono::milliseconds(1));
+    this->throughput = bytes / (transfer_time.count() / 1000000.0);
+    this->measured_at = std::time(nullptr);
+
+    return this->save();
+}
+
+TransferSettings Link::choose() const
+{
+    TransferSettings settings;
+
+    // compressing costs more CPU time than it saves on fast links
+    if (this->throughput < 1 * MEGABYTE)
+        settings.compression_level = 6;
+    else if (this->throughput < 10 * MEGABYTE)
+        settings.compression_level = 1;
+
+    // on fast links the cipher becomes the bottleneck; the list is a
+    // preference order so hosts that don't support one fall back
+    if (this->throughput >= 10 * MEGABYTE)
+    {
+        if (has_aes_instructions())
+            settings.ciphers = "aes128-gcm@openssh.com,chacha20-poly1305@openssh.com,aes128-ctr";
+        else
+            settings.ciphers = "chacha20-poly1305@openssh.com,aes128-gcm@openssh.com,aes128-ctr";
+    }
+
+    // a single stream can't fill a link with a high round trip
+    if (this->round_trip >= std::chrono::milliseconds(50))
+        settings.streams = 4;
+    else if (this->round_trip >= std::chrono::milliseconds(10))
+        settings.streams = 2;
+
+    return settings;
+}
@@ -0,0 +1,184 @@
+#include "logs.hpp"
+
+#include <thread>
+
+using namespace asyd;
+
+// parses "<seconds>.<microseconds> <message>" as written by journalctl -o
+// short-unix; false for other lines (e.g., "-- Boot ... --")
+static bool parse_journal_line(const std::string& line, int64_t& timestamp_us, std::string& message)
+{
+    size_t separator = line.find(' ');
+    size_t dot = line.find('.');
+    if (separator == std::string::npos || dot == std::string::npos || dot > separator || dot == 0)
+        return false;
+
+    for (size_t i = 0; i < separator; ++i)
+        if (i != dot && (line[i] < '0' || line[i] > '9'))
+            return false;
+
+    // the fraction is normally 6 digits, but pad/cut it to be safe
+    std::string fraction = line.substr(dot + 1, separator - dot - 1);
+    fraction.resize(6, '0');
+
+    timestamp_us = std::stoll(line.substr(0, dot)) * 1000000 + std::stoll(fraction);
+    message = line.substr(separator + 1);
+    return true;
+}
+
+LogMerger::LogMerger(std::chrono::milliseconds reorder_window, size_t max_buffered_entries)
+{
+    this->reorder_window = reorder_window;
+    this->max_buffered_entries = std::max<size_t>(max_buffered_entries, 1);
+}
+
+void LogMerger::add_source(
+    const Server& server,
+    const std::vector<std::string>& service_names,
+    const std::string& label)
+{
+    this->add_source([server, service_names](
+            int lines,
+            bool follow,
+            const std::function<bool(const std::string&)>& on_line,
+            const std::atomic<bool>* cancelled) {
+        server.stream_journal(service_names, lines, follow, on_line, cancelled);
+    }, label);
+}
+
+void LogMerger::add_source(const reader_fn& reader, const std::string& label)
+{
+    auto source = std::make_unique<Source>();
+    source->reader = reader;
+    source->label = label;
+    this->sources.push_back(std::move(source));
+}
+
+void LogMerger::read_source(Source& source, int lines, bool follow)
+{
+    source.reader(lines, follow, [&](const std::string& line) {
+        Entry entry;
+        if (!parse_journal_line(line, entry.timestamp_us, entry.message))
+        {
+            // a continuation line of a multi-line message is indented
+            // to the message and belongs to the source's last entry
+            if (line.empty() || line[0] != ' ' || source.last_timestamp_us == 0)
+                return true;
+
+            size_t spaces = std::min(line.find_first_not_of(' '), line.length());
+            std::string continuation = line.substr(std::min(spaces, source.continuation_indent));
+
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (!source.entries.empty())
+            {
+                source.entries.back().message += "\n" + continuation;
+                return !this->cancelled.load();
+            }
+
+            // the first line is printed already
+            entry.timestamp_us = source.last_timestamp_us;
+            entry.message = continuation;
+        }
+        else
+        {
+            // "<timestamp> <identifier>[<pid>]: <message>"
+            size_t message_start = entry.message.find(": ");
+            source.continuation_indent = line.length() - entry.message.length()
+                + (message_start == std::string::npos ? 0 : message_start + 2);
+        }
+        entry.source = source.label;
+
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        // stops reading (the pipe fills up and the remote side waits)
+        // until the merge caught up
+        this->entries_changed.wait(lock, [&]() {
+            return source.entries.size() < this->max_buffered_entries || this->cancelled;
+        });
+
+        source.entries.push_back(entry);
+        source.arrivals.push_back(std::chrono::steady_clock::now());
+        source.last_timestamp_us = entry.timestamp_us;
+        this->entries_changed.notify_all();
+
+        return !this->cancelled.load();
+    }, &this->cancelled);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    source.ended = true;
+    this->entries_changed.notify_all();
+}
+
+LogMerger::Source* LogMerger::next_source(std::chrono::steady_clock::time_point now) const
+{
+    Source* oldest = nullptr;
+    for (const auto& source : this->sources)
+        if (!source->entries.empty() && (oldest == nullptr || source->entries.front().timestamp_us < oldest->entries.front().timestamp_us))
+            oldest = source.get();
+
+    if (oldest == nullptr)
+        return nullptr;
+
+    // waited long enough for the silent sources
+    if (now - oldest->arrivals.front() >= this->reorder_window)
+        return oldest;
+
+    // any source that is still running could still deliver an older entry,
+    // unless it already went past the oldest entry's time
+    int64_t timestamp_us = oldest->entries.front().timestamp_us;
+    for (const auto& source : this->sources)
+    {
+        if (source->ended || !source->entries.empty())
+            continue;
+
+        if (source->last_timestamp_us < timestamp_us)
+            return nullptr;
+    }
+
+    return oldest;
+}
+
+void LogMerger::run(
+    int lines,
+    bool follow,
+    const std::function<void(const Entry&)>& on_entry,
+    const std::function<bool()>& keep_running)
+{
+    this->cancelled = false;
+
+    std::vector<std::thread> readers;
+    for (auto& source : this->sources)
+        readers.emplace_back(&LogMerger::read_source, this, std::ref(*source), lines, follow);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (keep_running())
+    {
+        this->entries_changed.wait_for(lock, std::chrono::milliseconds(50));
+
+        while (Source* source = this->next_source(std::chrono::steady_clock::now()))
+        {
+            Entry entry = std::move(source->entries.front());
+            source->entries.pop_front();
+            source->arrivals.pop_front();
+            this->entries_changed.notify_all();
+
+            lock.unlock();
+            on_entry(entry);
+            lock.lock();
+        }
+
+        bool all_done = true;
+        for (const auto& source : this->sources)
+            all_done = all_done && source->ended && source->entries.empty();
+
+        if (all_done)
+            break;
+    }
+
+    this->cancelled = true;
+    this->entries_changed.notify_all();
+    lock.unlock();
+
+    for (std::thread& reader : readers)
+        reader.join();
+}
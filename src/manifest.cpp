@@ -0,0 +1,99 @@
+#include "manifest.hpp"
+#include "config.hpp"
+#include "util.hpp"
+
+#include <fstream>
+#include <set>
+
+using namespace asyd;
+
+// settings a new project can't do without
+static const std::vector<std::string> REQUIRED_KEYS = { "server_hostname", "working_directory", "entry_point" };
+
+bool Manifest::fail(size_t line, const std::string& message)
+{
+    this->error = "line " + std::to_string(line) + ": " + message;
+    return false;
+}
+
+bool Manifest::from_file(const std::string& filepath)
+{
+    this->projects.clear();
+    this->error = "";
+
+    std::ifstream manifest(filepath);
+    if (!manifest.is_open())
+    {
+        this->error = "couldn't open '" + filepath + "'";
+        return false;
+    }
+
+    std::vector<std::pair<std::string, std::string>> defaults;
+    std::set<std::string> names;
+
+    // only used to check the keys
+    Config config;
+
+    std::string current_line;
+    size_t line = 0;
+    while (std::getline(manifest, current_line))
+    {
+        line++;
+
+        size_t begin = current_line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || current_line[begin] == '#')
+            continue;
+
+        size_t end = current_line.find_last_not_of(" \t\r");
+        current_line = current_line.substr(begin, end - begin + 1);
+
+        if (current_line[0] == '[')
+        {
+            std::string name = current_line.substr(1, current_line.length() - 2);
+            if (current_line.back() != ']' || name.empty() || name[0] == '.' || name.find('/') != std::string::npos)
+                return this->fail(line, "invalid project name '" + current_line + "'");
+
+            if (!names.insert(name).second)
+                return this->fail(line, "project '" + name + "' is declared twice");
+
+            Project project;
+            project.name = name;
+            project.line = line;
+            project.settings = defaults;
+            this->projects.push_back(project);
+            continue;
+        }
+
+        if (current_line.find('=') == std::string::npos)
+            return this->fail(line, "expected key=value or [project-name]");
+
+        auto [key, value] = asyd::util::parse_line(current_line);
+        if (key == "project_name" || !config.set(key, value))
+            return this->fail(line, "unknown setting '" + key + "'");
+
+        if (key == "working_directory" && value.length() > 0 && value[0] != '/')
+            return this->fail(line, "working_directory must be a full path starting with '/'");
+
+        if (this->projects.empty())
+            defaults.emplace_back(key, value);
+        else
+            this->projects.back().settings.emplace_back(key, value);
+    }
+
+    for (const Project& project : this->projects)
+    {
+        for (const std::string& required_key : REQUIRED_KEYS)
+        {
+            bool is_set = false;
+            for (const auto& [key, value] : project.settings)
+                is_set = key == required_key ? value.length() > 0 : is_set;
+
+            // existing projects already have them in their config
+            bool exists = std::filesystem::exists(asyd::util::get_asyd_project_dir(project.name) + "config.cfg");
+            if (!is_set && !exists)
+                return this->fail(project.line, "project '" + project.name + "' needs " + required_key);
+        }
+    }
+
+    return true;
+}
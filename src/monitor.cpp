@@ -0,0 +1,130 @@
+#include "monitor.hpp"
+#include "util.hpp"
+
+#include <future>
+#include <sstream>
+
+using namespace asyd;
+
+static const char* UNIT_PATTERN = "asyd-*.service";
+static const char* PROPERTIES = "Id,ActiveState,CPUUsageNSec,MemoryCurrent,TasksCurrent,IOReadBytes,IOWriteBytes,NRestarts";
+
+void Monitor::add_server(const Server& server)
+{
+    this->servers.push_back(server);
+}
+
+bool Monitor::open()
+{
+    bool all_open = true;
+    for (Server& server : this->servers)
+        all_open = server.open_connection() && all_open;
+
+    return all_open;
+}
+
+void Monitor::close()
+{
+    for (Server& server : this->servers)
+        server.close_connection();
+}
+
+size_t Monitor::sample(std::vector<UnitStats>& stats)
+{
+    stats.clear();
+
+    std::vector<std::future<std::pair<bool, std::string>>> samples;
+    for (const Server& server : this->servers)
+    {
+        samples.push_back(std::async(std::launch::async, [&server]() {
+            std::string output;
+            bool reached = server.fetch_unit_properties(UNIT_PATTERN, PROPERTIES, output);
+            return std::make_pair(reached, output);
+        }));
+    }
+
+    size_t unreachable = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        auto [reached, output] = samples[i].get();
+        if (!reached)
+        {
+            unreachable++;
+            continue;
+        }
+
+        this->parse_sample(this->servers[i].get_hostname(), output, stats);
+    }
+
+    return unreachable;
+}
+
+void Monitor::parse_sample(
+    const std::string& hostname,
+    const std::string& output,
+    std::vector<UnitStats>& stats)
+{
+    double uptime = 0;
+    size_t uptime_start = output.rfind("@@uptime");
+    if (uptime_start != std::string::npos)
+        uptime = std::atof(output.c_str() + uptime_start + 8);
+
+    // one block of Key=Value lines per unit, separated by empty lines
+    std::vector<std::map<std::string, std::string>> units(1);
+    std::istringstream lines(output.substr(0, uptime_start));
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        size_t separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            if (!units.back().empty())
+                units.emplace_back();
+            continue;
+        }
+
+        units.back()[line.substr(0, separator)] = line.substr(separator + 1);
+    }
+
+    for (auto& properties : units)
+    {
+        if (properties["Id"].empty())
+            continue;
+
+        UnitStats unit;
+        unit.hostname = hostname;
+        unit.unit_name = properties["Id"].substr(properties["Id"].rfind("asyd-", 0) == 0 ? 5 : 0);
+        unit.state = properties["ActiveState"];
+        unit.memory_bytes = asyd::util::parse_counter(properties["MemoryCurrent"]);
+        unit.tasks = asyd::util::parse_counter(properties["TasksCurrent"]);
+        unit.restarts = asyd::util::parse_counter(properties["NRestarts"]);
+
+        Counters counters;
+        counters.uptime = uptime;
+        counters.cpu_usage_nsec = asyd::util::parse_counter(properties["CPUUsageNSec"]);
+        counters.io_read_bytes = asyd::util::parse_counter(properties["IOReadBytes"]);
+        counters.io_write_bytes = asyd::util::parse_counter(properties["IOWriteBytes"]);
+
+        Counters& last = this->previous[hostname + "|" + unit.unit_name];
+        double elapsed = counters.uptime - last.uptime;
+
+        // counters start over when the service restarts, which shows
+        // as a counter going down
+        auto rate = [elapsed](int64_t current, int64_t previous) {
+            if (elapsed <= 0 || current < 0 || previous < 0 || current < previous)
+                return -1.0;
+            return (current - previous) / elapsed;
+        };
+
+        if (last.uptime > 0)
+        {
+            double cpu_rate = rate(counters.cpu_usage_nsec, last.cpu_usage_nsec);
+            unit.cpu_percent = cpu_rate < 0 ? -1 : cpu_rate / 1e9 * 100;
+            unit.io_read_rate = rate(counters.io_read_bytes, last.io_read_bytes);
+            unit.io_write_rate = rate(counters.io_write_bytes, last.io_write_bytes);
+        }
+
+        last = counters;
+        stats.push_back(unit);
+    }
+}
@@ -0,0 +1,324 @@
+#include "planner.hpp"
+#include "config.hpp"
+#include "server.hpp"
+#include "scanner.hpp"
+
+#include <fstream>
+
+using namespace asyd;
+
+// unit names as shown in the plan, e.g., "api@0.service, asyd-api@1.service"
+static std::string join_units(const std::vector<std::string>& unit_names)
+{
+    std::string joined = "";
+    for (const std::string& unit_name : unit_names)
+        joined += (joined.empty() ? "" : ", asyd-") + unit_name;
+
+    return joined;
+}
+
+Planner::Planner(const Config& config, const Server& server, const std::string& config_directory)
+    : config(config), server(server)
+{
+    this->config_directory = config_directory;
+    this->server_project_dir = config.get_server_home_directory() + "/.asyd/" + config.get_project_name();
+}
+
+void Planner::set_server_project_dir(const std::string& directory)
+{
+    this->server_project_dir = directory;
+}
+
+bool Planner::plan()
+{
+    this->steps.clear();
+    this->error = "";
+    this->scan_error = false;
+
+    if (!this->config.write_systemd_files(this->config_directory))
+    {
+        this->error = "couldn't write the systemd files into '" + this->config_directory + "'";
+        return false;
+    }
+
+    std::string output;
+    if (!this->server.fetch_state(
+            this->server_project_dir,
+            this->config.get_systemd_files(),
+            this->config.get_activation_units(),
+            output))
+    {
+        this->error = "couldn't fetch the state of '" + this->config.get_server_hostname() + "'";
+        return false;
+    }
+
+    this->parse_state(output);
+
+    // an empty plan would look like there's nothing to deploy
+    if (!this->diff_tree())
+    {
+        this->error = "the working directory '" + this->config.get_working_directory() + "' couldn't be read or has no files";
+        this->scan_error = true;
+        return false;
+    }
+
+    if (!this->remote_directory_exists)
+        this->steps.push_back({ StepType::CREATE_DIRECTORY, this->server_project_dir });
+
+    if (!this->changed_files.empty())
+        this->steps.push_back({ StepType::COPY_FILES, this->server_project_dir });
+
+    bool systemd_files_changed = false;
+    for (const std::string& systemd_file : this->config.get_systemd_files())
+    {
+        auto remote_file = this->remote_systemd_files.find(systemd_file);
+        if (remote_file != this->remote_systemd_files.end() && remote_file->second == this->read_systemd_file(systemd_file))
+            continue;
+
+        this->steps.push_back({ StepType::COPY_SYSTEMD_FILE, systemd_file });
+        systemd_files_changed = true;
+    }
+
+    // reloading is expensive on hosts with many units
+    if (systemd_files_changed)
+        this->steps.push_back({ StepType::RELOAD_DAEMON, "" });
+
+    // enabling is a no-op for units that already are
+    if (this->remote_enabled != "enabled")
+        for (const std::string& unit_name : this->config.get_activation_units())
+            this->steps.push_back({ StepType::ENABLE, unit_name });
+
+    std::string activation_units = join_units(this->config.get_activation_units());
+    std::string restart_units = join_units(this->config.get_restart_units());
+
+    if (this->remote_active != "active")
+        this->steps.push_back({ StepType::START, activation_units });
+    else if (systemd_files_changed && !this->config.is_job())
+        this->steps.push_back({ StepType::RESTART, restart_units });
+    else if (!this->changed_files.empty() && !this->config.is_job())
+        this->steps.push_back({ StepType::APPLY_CHANGES, restart_units });
+
+    return true;
+}
+
+void Planner::parse_state(const std::string& output)
+{
+    this->remote_directory_exists = false;
+    this->remote_systemd_files.clear();
+    this->remote_enabled = "";
+    this->remote_active = "";
+    this->remote_manifest.clear();
+
+    std::string section = "";
+    std::string systemd_file = "";
+
+    for (const std::string& line : asyd::util::split(output, '\n'))
+    {
+        if (line.rfind("@@unit ", 0) == 0)
+        {
+            section = "unit";
+            systemd_file = line.substr(7);
+            continue;
+        }
+
+        if (line == "@@enabled" || line == "@@active" || line == "@@manifest")
+        {
+            section = line.substr(2);
+            continue;
+        }
+
+        if (line == "@@exists")
+        {
+            this->remote_directory_exists = true;
+            continue;
+        }
+
+        if (section == "unit")
+        {
+            std::string& content = this->remote_systemd_files[systemd_file];
+            content += (content.empty() ? "" : "\n") + line;
+        }
+        // with several units (instances) the first one that
+        // isn't enabled/active decides
+        else if (section == "enabled" && (this->remote_enabled.empty() || this->remote_enabled == "enabled"))
+            this->remote_enabled = line;
+        else if (section == "active" && (this->remote_active.empty() || this->remote_active == "active"))
+            this->remote_active = line;
+        else if (section == "manifest")
+        {
+            // path|size|mtime with fractional seconds
+            size_t mtime_start = line.rfind('|');
+            size_t size_start = line.rfind('|', mtime_start - 1);
+            if (mtime_start == std::string::npos || size_start == std::string::npos)
+                continue;
+
+            std::string mtime = line.substr(mtime_start + 1);
+            this->remote_manifest[line.substr(0, size_start)] = line.substr(size_start + 1, mtime_start - size_start - 1)
+                + "|" + mtime.substr(0, mtime.find('.'));
+        }
+    }
+}
+
+bool Planner::diff_tree()
+{
+    this->changed_files.clear();
+
+    // the manifest (like the scanner) only has regular files, so only
+    // they decide whether files are copied; the copy itself brings the
+    // whole tree (see Server::copy_changes_from_local()); planning only
+    // needs size/mtime
+    Scanner scanner(this->config.get_working_directory(), this->config_directory + "/scan.cache");
+    // a project has at least its entry point
+    if (!scanner.scan(false) || scanner.get_entries().empty())
+        return false;
+
+    for (const auto& [path, entry] : scanner.get_entries())
+    {
+        std::string local = std::to_string(entry.size) + "|" + std::to_string(entry.get_mtime_sec());
+
+        auto remote = this->remote_manifest.find(path);
+        if (remote == this->remote_manifest.end() || remote->second != local)
+            this->changed_files.push_back(path);
+    }
+
+    return true;
+}
+
+std::string Planner::read_systemd_file(const std::string& name) const
+{
+    std::ifstream systemd_file(this->config_directory + "/" + name);
+    if (!systemd_file.is_open())
+        return "";
+
+    std::string content = "";
+    std::string line;
+    while (std::getline(systemd_file, line))
+    {
+        for (const std::string& token : asyd::util::split(line, '\n'))
+            content += (content.empty() ? "" : "\n") + token;
+    }
+
+    return content;
+}
+
+std::string Planner::describe(const Step& step) const
+{
+    switch (step.type)
+    {
+        case StepType::CREATE_DIRECTORY:
+            return "create directory " + step.target;
+        case StepType::COPY_FILES:
+            return "copy " + std::to_string(this->changed_files.size()) + " changed file(s) to " + step.target;
+        case StepType::COPY_SYSTEMD_FILE:
+            return "copy systemd file asyd-" + step.target;
+        case StepType::RELOAD_DAEMON:
+            return "systemctl daemon-reload";
+        case StepType::ENABLE:
+            return "enable asyd-" + step.target;
+        case StepType::START:
+            return "start asyd-" + step.target;
+        case StepType::RESTART:
+            return "restart asyd-" + step.target + " (systemd file changed)";
+        case StepType::APPLY_CHANGES:
+            return "restart/reload asyd-" + step.target + " depending on the changed files";
+    }
+
+    return "";
+}
+
+bool Planner::execute(ChangeAction& action, std::chrono::milliseconds& time_to_ready)
+{
+    return this->transfer() && this->activate(action, time_to_ready);
+}
+
+bool Planner::transfer()
+{
+    return this->transfer_files() && this->transfer_systemd_files();
+}
+
+bool Planner::transfer_files()
+{
+    this->copied_files.clear();
+
+    for (const Step& step : this->steps)
+    {
+        bool success = true;
+
+        switch (step.type)
+        {
+            case StepType::CREATE_DIRECTORY:
+                success = this->server.create_directory(step.target);
+                break;
+            case StepType::COPY_FILES:
+                success = this->server.copy_changes_from_local(this->config.get_working_directory(), step.target, this->changed_files, this->copied_files)
+                    && this->server.chmod("+x", step.target + "/" + this->config.get_entry_point());
+                break;
+            default:
+                // done in transfer_systemd_files() or activate()
+                break;
+        }
+
+        if (!success)
+            return false;
+    }
+
+    return true;
+}
+
+bool Planner::transfer_systemd_files()
+{
+    for (const Step& step : this->steps)
+        if (step.type == StepType::COPY_SYSTEMD_FILE && !this->server.copy_systemd_file(this->config_directory, step.target))
+            return false;
+
+    return true;
+}
+
+bool Planner::has_changed_systemd_files() const
+{
+    for (const Step& step : this->steps)
+        if (step.type == StepType::COPY_SYSTEMD_FILE)
+            return true;
+
+    return false;
+}
+
+bool Planner::activate(ChangeAction& action, std::chrono::milliseconds& time_to_ready) const
+{
+    action = ChangeAction::NONE;
+    time_to_ready = std::chrono::milliseconds(0);
+
+    for (const Step& step : this->steps)
+    {
+        bool success = true;
+
+        switch (step.type)
+        {
+            case StepType::RELOAD_DAEMON:
+                success = this->server.reload_service();
+                break;
+            case StepType::ENABLE:
+                success = this->server.enable_service(step.target);
+                break;
+            case StepType::START:
+                success = this->config.start_service(this->server, false, time_to_ready);
+                action = ChangeAction::RESTART;
+                break;
+            case StepType::RESTART:
+                success = this->config.start_service(this->server, true, time_to_ready);
+                action = ChangeAction::RESTART;
+                break;
+            case StepType::APPLY_CHANGES:
+                success = this->config.apply_changes(this->server, this->copied_files, action, time_to_ready);
+                break;
+            default:
+                // done in transfer()
+                break;
+        }
+
+        if (!success)
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,170 @@
+#include "relay.hpp"
+#include "config.hpp"
+#include "scanner.hpp"
+#include "server.hpp"
+
+#include <future>
+
+using namespace asyd;
+
+Relay::Relay(const Config& config)
+    : config(config)
+{
+}
+
+std::string Relay::relay_path() const
+{
+    return ".asyd/.relay/" + this->config.get_project_name();
+}
+
+std::string Relay::project_path() const
+{
+    return ".asyd/" + this->config.get_project_name();
+}
+
+Server Relay::target_server(const std::string& hostname) const
+{
+    Server server;
+    server.set_hostname(hostname);
+    server.set_jump_host(this->config.get_relay_hostname());
+    server.set_is_root(this->config.get_service_username() == "sudo");
+    return server;
+}
+
+bool Relay::deploy(std::vector<TargetResult>& results) const
+{
+    results.clear();
+    for (const std::string& target : this->config.get_relay_targets())
+    {
+        TargetResult result;
+        result.hostname = target;
+        result.project_name = this->config.get_project_name();
+        results.push_back(result);
+    }
+
+    // the only upload over the link to the relay
+    Server relay;
+    relay.set_hostname(this->config.get_relay_hostname());
+
+    // sized for the BandwidthScheduler
+    Scanner scanner(this->config.get_working_directory(),
+        asyd::util::get_asyd_project_dir(this->config.get_project_name()) + "scan.cache");
+
+    if (!scanner.scan(false)
+        || !relay.create_directory(".asyd/.relay")
+        || !relay.copy_from_local(this->config.get_working_directory(), this->relay_path(), scanner.get_total_size()))
+    {
+        // none of the targets got anything
+        for (TargetResult& result : results)
+            result.message = "couldn't upload to the relay";
+        return false;
+    }
+
+    this->distribute(results);
+
+    std::vector<std::future<void>> activations;
+    for (TargetResult& result : results)
+        if (result.success)
+            activations.push_back(std::async(std::launch::async, &Relay::activate, this, std::ref(result)));
+
+    for (auto& activation : activations)
+        activation.wait();
+
+    return true;
+}
+
+void Relay::distribute(std::vector<TargetResult>& results) const
+{
+    // a host that has the payload and where it is stored on that host
+    struct Holder
+    {
+        Server server;
+        std::string path;
+    };
+
+    Server relay;
+    relay.set_hostname(this->config.get_relay_hostname());
+
+    std::vector<Holder> holders = { { relay, this->relay_path() } };
+
+    int fanout = this->config.get_relay_fanout();
+    size_t sends_per_holder = fanout > 0 ? static_cast<size_t>(fanout) : results.size();
+
+    size_t next_target = 0;
+    while (next_target < results.size())
+    {
+        // every holder sends to up to [sends_per_holder] targets in parallel
+        std::vector<std::pair<size_t, std::future<bool>>> sends;
+        for (const Holder& holder : holders)
+        {
+            for (size_t i = 0; i < sends_per_holder && next_target < results.size(); ++i, ++next_target)
+            {
+                sends.emplace_back(next_target, std::async(std::launch::async,
+                    [this, &holder, &results, next_target]() {
+                        return holder.server.forward_directory(holder.path, results[next_target].hostname, this->project_path());
+                    }));
+            }
+        }
+
+        std::vector<Holder> new_holders;
+        for (auto& [target_index, send] : sends)
+        {
+            results[target_index].success = send.get();
+            if (results[target_index].success)
+                new_holders.push_back({ this->target_server(results[target_index].hostname), this->project_path() });
+        }
+
+        // in a tree every host that received the payload forwards it next round
+        if (fanout > 0)
+            holders.insert(holders.end(), new_holders.begin(), new_holders.end());
+    }
+
+    // targets whose sender failed get a second chance directly from the relay
+    for (TargetResult& result : results)
+    {
+        if (result.success)
+            continue;
+
+        result.success = relay.forward_directory(this->relay_path(), result.hostname, this->project_path());
+        if (!result.success)
+            result.message = "couldn't copy files from the relay";
+    }
+}
+
+void Relay::activate(TargetResult& result) const
+{
+    Server server = this->target_server(result.hostname);
+    std::string config_directory = asyd::util::get_asyd_project_dir(this->config.get_project_name());
+
+    result.success = false;
+
+    if (!server.chmod("+x", this->project_path() + "/" + this->config.get_entry_point()))
+    {
+        result.message = "couldn't make the entry point executable";
+        return;
+    }
+
+    if (!this->config.copy_systemd_files(server, config_directory) || !server.reload_service())
+    {
+        result.message = "couldn't install the systemd files";
+        return;
+    }
+
+    for (const std::string& unit_name : this->config.get_activation_units())
+    {
+        if (!server.enable_service(unit_name))
+        {
+            result.message = "couldn't enable the service";
+            return;
+        }
+    }
+
+    // jobs only need their timer running, they use the new files on their next run
+    if (!this->config.start_service(server, !this->config.is_job(), result.time_to_ready))
+    {
+        result.message = "couldn't restart the service";
+        return;
+    }
+
+    result.success = true;
+}
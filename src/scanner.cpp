@@ -0,0 +1,334 @@
+#include "scanner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace asyd;
+
+static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+static uint64_t fnv1a(uint64_t hash, const char* data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static unsigned int thread_count(unsigned int threads)
+{
+    if (threads > 0)
+        return threads;
+
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? cores : 4;
+}
+
+Scanner::Scanner(const std::string& root_directory, const std::string& cache_path)
+{
+    this->root_directory = root_directory;
+    this->cache_path = cache_path;
+}
+
+bool Scanner::scan(bool hash_files, unsigned int threads)
+{
+    auto start = std::chrono::steady_clock::now();
+    threads = thread_count(threads);
+
+    this->stats = Stats();
+    this->load_cache();
+
+    std::map<std::string, Entry> found;
+    if (!this->walk(threads, found))
+        return false;
+
+    // files that are unchanged since the last scan keep their hash
+    std::vector<std::pair<const std::string*, Entry*>> to_hash;
+    for (auto& [path, entry] : found)
+    {
+        auto cached = this->entries.find(path);
+        if (cached != this->entries.end()
+            && cached->second.inode == entry.inode
+            && cached->second.size == entry.size
+            && cached->second.mtime_ns == entry.mtime_ns)
+        {
+            entry.hash = cached->second.hash;
+            entry.hashed = cached->second.hashed;
+        }
+
+        if (hash_files && !entry.hashed && (!this->hash_filter || this->hash_filter(path)))
+            to_hash.push_back({ &path, &entry });
+    }
+
+    // every thread takes the next file until all are hashed; the entries
+    // are distinct map nodes so no locking is needed to write them
+    std::atomic<size_t> next_file{0};
+    std::atomic<uint64_t> bytes_hashed{0};
+    std::atomic<size_t> files_hashed{0};
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < std::min<size_t>(threads, to_hash.size()); ++i)
+    {
+        workers.emplace_back([&]() {
+            for (size_t file = next_file++; file < to_hash.size(); file = next_file++)
+            {
+                Entry& entry = *to_hash[file].second;
+                if (!Scanner::hash_file(this->root_directory + "/" + *to_hash[file].first, entry.hash))
+                    continue;
+
+                entry.hashed = true;
+                bytes_hashed += entry.size;
+                files_hashed++;
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    this->entries = std::move(found);
+    this->save_cache();
+
+    this->stats.files = this->entries.size();
+    this->stats.files_hashed = files_hashed;
+    this->stats.bytes_hashed = bytes_hashed;
+    this->stats.duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    return true;
+}
+
+bool Scanner::walk(unsigned int threads, std::map<std::string, Entry>& found) const
+{
+    struct stat root_stat;
+    if (stat(this->root_directory.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode))
+        return false;
+
+    // directories (relative to the root) that still have to be read; the
+    // walk is done once the queue is empty and no thread is reading one
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    std::deque<std::string> directories = { "" };
+    size_t pending_directories = 1;
+
+    // a directory that can't be read would look like one without files
+    bool unreadable = false;
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]() {
+            while (true)
+            {
+                std::string directory;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    queue_changed.wait(lock, [&]() { return !directories.empty() || pending_directories == 0; });
+                    if (directories.empty())
+                        return;
+
+                    directory = directories.front();
+                    directories.pop_front();
+                }
+
+                std::vector<std::string> subdirectories;
+                std::vector<std::pair<std::string, Entry>> files;
+
+                std::string prefix = directory.empty() ? "" : directory + "/";
+                DIR* dir = opendir((this->root_directory + "/" + directory).c_str());
+                if (dir != nullptr)
+                {
+                    while (struct dirent* dir_entry = readdir(dir))
+                    {
+                        std::string name = dir_entry->d_name;
+                        if (name == "." || name == "..")
+                            continue;
+
+                        // relative to the open directory, symlinks aren't followed
+                        struct stat file_stat;
+                        if (fstatat(dirfd(dir), dir_entry->d_name, &file_stat, AT_SYMLINK_NOFOLLOW) != 0)
+                            continue;
+
+                        if (S_ISDIR(file_stat.st_mode))
+                            subdirectories.push_back(prefix + name);
+                        else if (S_ISREG(file_stat.st_mode))
+                        {
+                            Entry entry;
+                            entry.inode = file_stat.st_ino;
+                            entry.size = file_stat.st_size;
+                            entry.mtime_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000
+                                + file_stat.st_mtim.tv_nsec;
+                            files.push_back({ prefix + name, entry });
+                        }
+                    }
+
+                    closedir(dir);
+                }
+
+                // one removed since it was listed (e.g., while editing) is skipped
+                bool failed = dir == nullptr && errno != ENOENT;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                unreadable = unreadable || failed;
+                for (auto& file : files)
+                    found.insert(std::move(file));
+
+                directories.insert(directories.end(), subdirectories.begin(), subdirectories.end());
+                pending_directories += subdirectories.size();
+                pending_directories--;
+                queue_changed.notify_all();
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    return !unreadable;
+}
+
+bool Scanner::hash_file(const std::string& path, uint64_t& hash)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    hash = FNV_OFFSET_BASIS;
+
+    char buffer[65536];
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0)
+        hash = fnv1a(hash, buffer, bytes_read);
+
+    close(fd);
+    return bytes_read == 0;
+}
+
+bool Scanner::load_cache()
+{
+    this->entries.clear();
+
+    std::ifstream cache(this->cache_path);
+    if (!cache.is_open())
+        return false;
+
+    // inode|size|mtime_ns|hash (- if not hashed)|path
+    std::string line;
+    while (std::getline(cache, line))
+    {
+        size_t separators[4];
+        size_t position = 0;
+        bool valid = true;
+        for (size_t& separator : separators)
+        {
+            separator = line.find('|', position);
+            if (separator == std::string::npos)
+            {
+                valid = false;
+                break;
+            }
+            position = separator + 1;
+        }
+
+        if (!valid)
+            continue;
+
+        // a corrupt line only means that file is scanned again
+        try
+        {
+            Entry entry;
+            entry.inode = std::stoull(line.substr(0, separators[0]));
+            entry.size = std::stoll(line.substr(separators[0] + 1, separators[1] - separators[0] - 1));
+            entry.mtime_ns = std::stoll(line.substr(separators[1] + 1, separators[2] - separators[1] - 1));
+
+            std::string hash = line.substr(separators[2] + 1, separators[3] - separators[2] - 1);
+            entry.hashed = hash != "-";
+            if (entry.hashed)
+                entry.hash = std::stoull(hash, nullptr, 16);
+
+            this->entries[line.substr(separators[3] + 1)] = entry;
+        }
+        catch (const std::exception&)
+        {
+            continue;
+        }
+    }
+
+    return true;
+}
+
+bool Scanner::save_cache() const
+{
+    // written next to the cache and renamed so an interrupted scan
+    // never leaves a truncated cache behind
+    std::string temporary_path = this->cache_path + ".tmp";
+
+    std::ofstream cache(temporary_path);
+    if (!cache.is_open())
+        return false;
+
+    char hash[17];
+    for (const auto& [path, entry] : this->entries)
+    {
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(entry.hash));
+        cache << entry.inode << "|" << entry.size << "|" << entry.mtime_ns << "|"
+            << (entry.hashed ? hash : "-") << "|" << path << "\n";
+    }
+
+    cache.close();
+    if (!cache)
+        return false;
+
+    return std::rename(temporary_path.c_str(), this->cache_path.c_str()) == 0;
+}
+
+const std::map<std::string, Scanner::Entry>& Scanner::get_entries() const
+{
+    return this->entries;
+}
+
+const Scanner::Stats& Scanner::get_stats() const
+{
+    return this->stats;
+}
+
+uint64_t Scanner::get_total_size() const
+{
+    uint64_t total_size = 0;
+    for (const auto& [path, entry] : this->entries)
+        total_size += entry.size;
+
+    return total_size;
+}
+
+uint64_t Scanner::get_tree_hash(const std::function<bool(const std::string&)>& include) const
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (const auto& [path, entry] : this->entries)
+    {
+        if (include && !include(path))
+            continue;
+
+        hash = fnv1a(hash, path.c_str(), path.length() + 1);
+        hash = fnv1a(hash, reinterpret_cast<const char*>(&entry.hash), sizeof(entry.hash));
+    }
+
+    return hash;
+}
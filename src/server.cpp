@@ -1,5 +1,13 @@
 #include "server.hpp"
 #include "command.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <unistd.h>
 
 using namespace asyd;
 
@@ -19,8 +27,7 @@ bool Server::fetch_info()
     Command command;
     
     // get home directory
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("pwd ~", false)
         .addQuote();
@@ -31,8 +38,7 @@ bool Server::fetch_info()
     this->home_directory = command.get_output();
 
     // get bash directory
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("whereis bash", false)
         .addQuote();
@@ -61,12 +67,181 @@ void Server::set_hostname(const std::string& hostname)
     this->hostname = hostname;
 }
 
-bool Server::create_directory(const std::string& path) const
+// makes the control paths of the connections of this process unique
+static std::atomic<unsigned int> connection_counter{0};
+
+bool Server::open_connection()
 {
+    // %C is expanded by ssh into a hash of the connection parameters which
+    // keeps the socket path short and unique per host; the pid and a counter
+    // give every connection its own master, so closing it never ends the
+    // sessions of another asyd process (or Server) to the same host
+    std::string control_path = "/tmp/asyd-" + std::to_string(getpid()) + "-"
+        + std::to_string(connection_counter++) + "-%C";
+
     Command command;
 
+    // the master connection is backgrounded (-f) and kept alive for up to
+    // 10 idle minutes (ControlPersist); its stdout is detached so we don't
+    // wait on it. Commands issued after it expired fall back to a regular
+    // connection.
     command.add("ssh")
+        .add("-f")
+        .add("-N")
+        .add("-o ControlMaster=yes")
+        .add("-o ControlPersist=600")
+        .add("-o ControlPath=" + control_path)
+        .add(this->ssh_options(), false)
         .add(this->hostname)
+        .add("> /dev/null", false);
+
+    if (!command.execute())
+        return false;
+
+    this->control_path = control_path;
+    return true;
+}
+
+void Server::close_connection()
+{
+    if (this->control_path.length() == 0)
+        return;
+
+    Command command;
+
+    command.add("ssh")
+        .add("-o ControlPath=" + this->control_path)
+        .add("-O exit")
+        .add(this->hostname)
+        .add("> /dev/null 2>&1", false);
+
+    command.execute();
+    this->control_path = "";
+}
+
+void Server::set_jump_host(const std::string& jump_host)
+{
+    this->jump_host = jump_host;
+}
+
+void Server::set_transfer_settings(const TransferSettings& transfer_settings)
+{
+    this->transfer_settings = transfer_settings;
+}
+
+const TransferSettings& Server::get_transfer_settings() const
+{
+    return this->transfer_settings;
+}
+
+void Server::set_link_dest(const std::string& link_dest)
+{
+    this->link_dest = link_dest;
+}
+
+bool Server::is_connected() const
+{
+    return this->control_path.length() > 0;
+}
+
+bool Server::measure_round_trip(int samples, std::chrono::microseconds& round_trip) const
+{
+    round_trip = std::chrono::microseconds::max();
+
+    for (int i = 0; i < samples; ++i)
+    {
+        Command command;
+
+        this->ssh(command)
+            .addQuote()
+            .add("true", false)
+            .addQuote();
+
+        auto start = std::chrono::steady_clock::now();
+        if (!command.execute())
+            return false;
+
+        round_trip = std::min(round_trip, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start));
+    }
+
+    return samples > 0;
+}
+
+bool Server::measure_upload(size_t bytes, std::chrono::microseconds& duration) const
+{
+    Command command;
+
+    // random data so neither ssh nor anything in between can compress it
+    command.add("head -c " + std::to_string(bytes) + " /dev/urandom |");
+
+    this->ssh(command)
+        .addQuote()
+        .add("cat > /dev/null", false)
+        .addQuote();
+
+    auto start = std::chrono::steady_clock::now();
+    if (!command.execute())
+        return false;
+
+    duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return true;
+}
+
+std::string Server::ssh_options() const
+{
+    std::string options = "";
+
+    if (this->control_path.length() > 0)
+        options += "-o ControlPath=" + this->control_path + " ";
+
+    // -A forwards the agent so the server can in turn connect to other
+    // servers (see Relay)
+    if (this->jump_host.length() > 0)
+        options += "-A -J " + this->jump_host + " ";
+
+    if (this->transfer_settings.ciphers.length() > 0)
+        options += "-c " + this->transfer_settings.ciphers + " ";
+
+    return options;
+}
+
+Command& Server::ssh(Command& command) const
+{
+    return command.add("ssh")
+        .add(this->ssh_options(), false)
+        .add(this->hostname);
+}
+
+BandwidthScheduler::Ticket Server::schedule_transfer(const std::string& description, uint64_t bytes) const
+{
+    return BandwidthScheduler::get().acquire(this->hostname, description, bytes, this->transfer_settings.priority);
+}
+
+Command& Server::rsync(Command& command, const BandwidthScheduler::Ticket& ticket) const
+{
+    command.add("rsync");
+
+    if (ticket.get_bandwidth_limit() > 0)
+        command.add("--bwlimit=" + std::to_string(ticket.get_bandwidth_limit()));
+
+    std::string options = this->ssh_options();
+    if (options.length() > 0)
+        command.add("-e \"ssh " + options + "\"");
+
+    if (this->transfer_settings.compression_level > 0)
+        command.add("--compress")
+            .add("--compress-level=" + std::to_string(this->transfer_settings.compression_level));
+
+    return command;
+}
+
+bool Server::create_directory(const std::string& path) const
+{
+    Command command;
+
+    this->ssh(command)
         .addQuote()
         .add("mkdir -p")
         .add(path, false)
@@ -80,15 +255,22 @@ bool Server::create_directory(const std::string& path) const
 
 bool Server::remove_directory(const std::string& path) const
 {
-    // NOTE: the path is sanitized beforehand
+    return this->remove_directory(std::vector<std::string>{ path });
+}
+
+bool Server::remove_directory(const std::vector<std::string>& paths) const
+{
+    // NOTE: the paths are sanitized beforehand
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
-        .add("rm -rf")
-        .add(path, false)
-        .addQuote();
+        .add("rm -rf");
+
+    for (size_t i = 0; i < paths.size(); ++i)
+        command.add(paths[i], i + 1 < paths.size());
+
+    command.addQuote();
 
     if (!command.execute())
         return false;
@@ -96,13 +278,49 @@ bool Server::remove_directory(const std::string& path) const
     return true;
 }
 
+bool Server::prepare_staging_directory(
+    const std::string& staging_path,
+    const std::string& previous_path) const
+{
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add("rm -rf " + staging_path + " " + previous_path + " &&")
+        .add("mkdir -p " + staging_path, false)
+        .addQuote();
+
+    return command.execute();
+}
+
+bool Server::activate_staging_directory(
+    const std::string& path,
+    const std::string& staging_path,
+    const std::string& previous_path) const
+{
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add("test -d " + staging_path + " &&")
+        .add("rm -rf " + previous_path + " &&")
+        .add("{ [ ! -d " + path + " ] || mv " + path + " " + previous_path + "; } &&")
+        .add("mv " + staging_path + " " + path, false)
+        .addQuote();
+
+    return command.execute();
+}
+
 bool Server::copy_from_local(
     const std::string& from_local_path,
-    const std::string& to_server_path) const
+    const std::string& to_server_path,
+    uint64_t bytes) const
 {
+    BandwidthScheduler::Ticket ticket = this->schedule_transfer(from_local_path + " to " + this->hostname, bytes);
+
     Command command;
 
-    command.add("rsync")
+    this->rsync(command, ticket)
         .add("-a")
         .add(from_local_path, false)
         .add("/")
@@ -116,14 +334,201 @@ bool Server::copy_from_local(
     return true;
 }
 
+bool Server::copy_from_local(
+    const std::string& from_local_path,
+    const std::string& to_server_path,
+    const std::vector<std::string>& relative_paths) const
+{
+    return this->copy_file_list(from_local_path, to_server_path, relative_paths, true, nullptr);
+}
+
+bool Server::copy_changes_from_local(
+    const std::string& from_local_path,
+    const std::string& to_server_path,
+    const std::vector<std::string>& relative_paths,
+    std::vector<std::string>& changed_paths) const
+{
+    changed_paths.clear();
+
+    // with a single stream the whole-tree copy below transfers the files
+    // just as well
+    if (this->transfer_settings.streams > 1 && relative_paths.size() > 1
+        && !this->copy_file_list(from_local_path, to_server_path, relative_paths, false, &changed_paths))
+        return false;
+
+    // the file list only has regular files; this brings symlinks and empty
+    // directories and only compares the files that are up to date by now
+    uint64_t bytes = 0;
+    for (const std::string& path : relative_paths)
+    {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(from_local_path + "/" + path, error);
+        bytes += error ? 0 : size;
+    }
+
+    BandwidthScheduler::Ticket ticket = this->schedule_transfer(from_local_path + " to " + this->hostname,
+        changed_paths.empty() ? bytes : 0);
+
+    Command command;
+
+    this->rsync(command, ticket)
+        .add("-a")
+        .add("--out-format='%i %n'");
+
+    if (!this->link_dest.empty())
+        command.add("--link-dest=" + this->link_dest);
+
+    command.add(from_local_path, false)
+        .add("/")
+        .add(this->hostname, false)
+        .add(":", false)
+        .add(to_server_path);
+
+    if (!command.execute())
+        return false;
+
+    Server::parse_itemized_changes(command.get_output(), changed_paths);
+    return true;
+}
+
+void Server::parse_itemized_changes(const std::string& output, std::vector<std::string>& changed_paths)
+{
+    for (const std::string& line : asyd::util::split(output, '\n'))
+    {
+        // the first character is the update type (<, >, c or h) and the
+        // second the file type; directories ('d') aren't files that changed
+        if (line.length() < 13 || line[1] == 'd' || std::string("<>ch").find(line[0]) == std::string::npos)
+            continue;
+
+        changed_paths.push_back(line.substr(12));
+    }
+}
+
+// makes the file lists of concurrent copies (threads and streams) unique
+static std::atomic<unsigned int> file_list_counter{0};
+
+bool Server::copy_file_list(
+    const std::string& from_local_path,
+    const std::string& to_server_path,
+    const std::vector<std::string>& relative_paths,
+    bool delete_missing,
+    std::vector<std::string>* changed_paths) const
+{
+    if (changed_paths != nullptr)
+        changed_paths->clear();
+
+    if (relative_paths.empty())
+        return true;
+
+    // several streams keep a link with a high round trip busy; the paths
+    // are dealt out round robin so big directories are spread over them
+    size_t streams = std::min<size_t>(std::max(this->transfer_settings.streams, 1), relative_paths.size());
+    std::vector<std::vector<std::string>> stream_paths(streams);
+    for (size_t i = 0; i < relative_paths.size(); ++i)
+        stream_paths[i % streams].push_back(relative_paths[i]);
+
+    std::vector<std::future<std::pair<bool, std::string>>> transfers;
+    for (const std::vector<std::string>& paths : stream_paths)
+    {
+        transfers.push_back(std::async(std::launch::async, [&, paths]() -> std::pair<bool, std::string> {
+            // rsync reads the list of paths to transfer from a file
+            std::string files_from = (std::filesystem::temp_directory_path()
+                / ("asyd-files-" + std::to_string(getpid()) + "-" + std::to_string(file_list_counter++))).string();
+
+            std::ofstream file_list(files_from);
+            if (!file_list.is_open())
+                return { false, "" };
+
+            for (const std::string& path : paths)
+                file_list << path << "\n";
+            file_list.close();
+
+            uint64_t bytes = 0;
+            for (const std::string& path : paths)
+            {
+                std::error_code error;
+                uint64_t size = std::filesystem::file_size(from_local_path + "/" + path, error);
+                bytes += error ? 0 : size;
+            }
+
+            BandwidthScheduler::Ticket ticket = this->schedule_transfer(
+                std::to_string(paths.size()) + " file(s) to " + this->hostname, bytes);
+
+            Command command;
+
+            this->rsync(command, ticket)
+                .add("-a");
+
+            // paths that no longer exist locally are deleted on the server
+            if (delete_missing)
+                command.add("--delete-missing-args");
+
+            // prints "<itemized changes> <path>" for every transferred item
+            if (changed_paths != nullptr)
+                command.add("--out-format='%i %n'");
+
+            if (!this->link_dest.empty())
+                command.add("--link-dest=" + this->link_dest);
+
+            command.add("--files-from=" + files_from)
+                .add(from_local_path, false)
+                .add("/")
+                .add(this->hostname, false)
+                .add(":", false)
+                .add(to_server_path);
+
+            bool success = command.execute();
+            std::filesystem::remove(files_from);
+
+            return { success, command.get_output() };
+        }));
+    }
+
+    bool success = true;
+    for (auto& transfer : transfers)
+    {
+        auto [transferred, output] = transfer.get();
+        success = success && transferred;
+
+        if (changed_paths != nullptr)
+            Server::parse_itemized_changes(output, *changed_paths);
+    }
+
+    return success;
+}
+
+bool Server::forward_directory(
+    const std::string& from_server_path,
+    const std::string& to_hostname,
+    const std::string& to_server_path) const
+{
+    Command command;
+
+    // the parent directory may not exist yet on the receiving server
+    std::string to_parent_path = std::filesystem::path(to_server_path).parent_path().string();
+
+    this->ssh(command)
+        .addQuote()
+        .add("rsync")
+        .add("-a")
+        .add("--rsync-path='mkdir -p " + to_parent_path + " && rsync'")
+        .add(from_server_path + "/")
+        .add(to_hostname + ":" + to_server_path, false)
+        .addQuote();
+
+    if (!command.execute())
+        return false;
+
+    return true;
+}
+
 bool Server::chmod(
     const std::string& chmod_options,
     const std::string& target_file) const
 {
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("chmod")
         .add(chmod_options)
@@ -140,9 +545,13 @@ bool Server::copy_systemd_file(
     const std::string& local_directory,
     const std::string& service_name) const
 {
+    std::error_code error;
+    uint64_t bytes = std::filesystem::file_size(local_directory + "/" + service_name, error);
+    BandwidthScheduler::Ticket ticket = this->schedule_transfer("asyd-" + service_name + " to " + this->hostname, error ? 0 : bytes);
+
     Command command;
 
-    command.add("rsync")
+    this->rsync(command, ticket)
         .add(local_directory, false)
         .add("/", false)
         .add(service_name)
@@ -166,8 +575,7 @@ bool Server::systemd_action(const std::string& action, const std::string& servic
 {
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("systemctl");
 
@@ -187,11 +595,42 @@ bool Server::systemd_action(const std::string& action, const std::string& servic
     return true;
 }
 
+bool Server::bulk_action(
+    const std::string& action,
+    const std::vector<std::string>& service_names,
+    std::vector<std::string>& states) const
+{
+    std::string systemctl = this->is_root ? "systemctl " : "systemctl --user ";
+    std::string units = "";
+    for (const std::string& service_name : service_names)
+        units += " asyd-" + service_name;
+
+    Command command;
+
+    // is-active exits non-zero if any unit isn't active, so only the
+    // output tells whether the server was reached
+    this->ssh(command)
+        .addQuote()
+        .add(systemctl + action + units + ";", true)
+        .add(systemctl + "is-active" + units, false)
+        .addQuote();
+
+    command.execute();
+
+    states = this->split_newlines(command.get_output());
+    return states.size() == service_names.size();
+}
+
 bool Server::reload_service() const
 {
     return this->systemd_action("daemon-reload", "");
 }
 
+bool Server::reload_unit(const std::string& service_name) const
+{
+    return this->systemd_action("try-reload-or-restart", service_name);
+}
+
 bool Server::enable_service(const std::string& service_name) const
 {
     return this->systemd_action("enable", service_name);
@@ -207,6 +646,11 @@ bool Server::stop_service(const std::string& service_name) const
     return this->systemd_action("stop", service_name);
 }
 
+bool Server::disable_service(const std::string& service_name) const
+{
+    return this->systemd_action("disable --now", service_name);
+}
+
 bool Server::restart_service(const std::string& service_name) const
 {
     return this->systemd_action("restart", service_name);
@@ -214,29 +658,217 @@ bool Server::restart_service(const std::string& service_name) const
 
 bool Server::remove_service(const std::string& service_name) const
 {
-    if (!this->stop_service(service_name))
+    // disable --now stops the unit as well; templates (project@.service)
+    // have no running unit to stop, disabling them disables their instances
+    bool is_template = service_name.find("@.") != std::string::npos;
+    std::string systemctl = this->is_root ? "systemctl " : "systemctl --user ";
+    std::string unit_path = this->is_root ? "/etc/systemd/system/" : "~/.config/systemd/user/";
+    unit_path += "asyd-" + service_name;
+
+    // a unit that isn't installed (anymore) is removed already
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add("test ! -e " + unit_path + " ||")
+        .add("{ " + systemctl + "disable " + (is_template ? "" : "--now ") + "asyd-" + service_name + " &&")
+        .add("rm " + unit_path + "; }", false)
+        .addQuote();
+
+    if (!command.execute())
         return false;
 
+    return true;
+}
+
+bool Server::fetch_state(
+    const std::string& server_project_dir,
+    const std::vector<std::string>& service_names,
+    const std::vector<std::string>& activation_service_names,
+    std::string& output) const
+{
+    std::string systemd_directory = this->is_root ? "/etc/systemd/system/" : "~/.config/systemd/user/";
+    std::string systemctl = this->is_root ? "systemctl " : "systemctl --user ";
+
+    std::string script = "";
+    for (const std::string& service_name : service_names)
+        script += "echo '@@unit " + service_name + "'; cat " + systemd_directory + "asyd-" + service_name + " 2>/dev/null; ";
+
+    std::string activation_units = "";
+    for (const std::string& activation_service_name : activation_service_names)
+        activation_units += " asyd-" + activation_service_name;
+
+    // one line per unit
+    script += "echo @@enabled; " + systemctl + "is-enabled" + activation_units + " 2>/dev/null; ";
+    script += "echo @@active; " + systemctl + "is-active" + activation_units + "; ";
+    script += "echo @@manifest; cd " + server_project_dir + " 2>/dev/null && echo @@exists && find . -type f -printf '%P|%s|%T@\\n'";
+
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
+        .addQuote()
+        .add(script, false)
         .addQuote();
 
-    if (this->is_root)
-        command.add("rm /etc/systemd/system/", false);
-    else
-        command.add("rm ~/.config/systemd/user/", false);
+    // the exit code is the one of the last command, so only the
+    // output tells whether the server was reached
+    command.execute();
+
+    output = command.get_output();
+    return output.find("@@manifest") != std::string::npos;
+}
 
-    command.add("asyd-" + service_name, false)
+bool Server::fetch_unit_files(const std::string& archive_path) const
+{
+    // ls lists only what exists and -T /dev/null keeps tar from
+    // refusing to write an empty archive when there are no units
+    std::string units = "";
+    for (const std::string directory : { "etc/systemd/system/", "\\${HOME#/}/.config/systemd/user/" })
+        units += directory + "asyd-* " + directory + "*.wants/asyd-* ";
+
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add("cd / && tar -cf - -T /dev/null \\$(ls -d " + units + "2>/dev/null)", false)
+        .addQuote()
+        .add(">")
+        .add(archive_path);
+
+    return command.execute();
+}
+
+bool Server::fetch_unit_properties(
+    const std::string& pattern,
+    const std::string& properties,
+    std::string& output) const
+{
+    std::string systemctl = this->is_root ? "systemctl " : "systemctl --user ";
+
+    Command command;
+
+    // the uptime is the host's own clock for computing rates, so the
+    // latency of the ssh call doesn't skew them
+    this->ssh(command)
+        .addQuote()
+        .add(systemctl + "show '" + pattern + "' --property=" + properties + ";", true)
+        .add("echo @@uptime; cut -d' ' -f1 /proc/uptime", false)
         .addQuote();
 
+    command.execute();
+
+    output = command.get_output();
+    return output.find("@@uptime") != std::string::npos;
+}
+
+bool Server::fetch_job_history(
+    const std::string& service_name,
+    const std::vector<std::string>& message_ids,
+    const std::string& fields,
+    const std::string& schedule,
+    int max_entries,
+    std::string& output) const
+{
+    std::string unit_name = "asyd-" + service_name;
+    std::string systemctl = this->is_root ? "systemctl " : "systemctl --user ";
+
+    // only messages of the service manager about the unit, so the job's
+    // own output doesn't crowd out the runs
+    std::string journalctl = this->is_root
+        ? "journalctl _PID=1 UNIT=" + unit_name + " "
+        : "journalctl --user USER_UNIT=" + unit_name + " ";
+    for (const std::string& message_id : message_ids)
+        journalctl += "MESSAGE_ID=" + message_id + " ";
+    journalctl += "-q -n " + std::to_string(max_entries) + " -o export --output-fields=" + fields + ";";
+
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add(journalctl, true)
+        .add("echo @@unit; " + systemctl + "show " + unit_name + " --property=ActiveState,CPUUsageNSec,MemoryCurrent;", true)
+        .add("echo @@schedule; systemd-analyze calendar --iterations=2 '" + schedule + "' 2>/dev/null;", true)
+        .add("echo @@now; date +%s", false)
+        .addQuote();
+
+    command.execute();
+
+    output = command.get_output();
+    return output.find("@@now") != std::string::npos;
+}
+
+bool Server::stream_journal(
+    const std::vector<std::string>& service_names,
+    int lines,
+    bool follow,
+    const std::function<bool(const std::string&)>& on_line,
+    const std::atomic<bool>* cancelled) const
+{
+    std::string journalctl = this->is_root ? "journalctl " : "journalctl --user ";
+    for (const std::string& service_name : service_names)
+        journalctl += "-u 'asyd-" + service_name + "' ";
+
+    // short-unix starts every entry with its timestamp
+    journalctl += "-o short-unix --no-hostname -q -n " + std::to_string(lines) + (follow ? " -f" : "");
+
+    Command command;
+
+    this->ssh(command)
+        .addQuote()
+        .add(journalctl, false)
+        .addQuote();
+
+    return command.stream(on_line, cancelled);
+}
+
+bool Server::run_command(
+    const std::string& directory,
+    const std::string& command,
+    int timeout_sec,
+    const std::function<bool(const std::string&)>& on_line,
+    const std::atomic<bool>* cancelled,
+    int& exit_status) const
+{
+    std::string script = "cd " + asyd::util::shell_quote(directory) + " && ";
+    if (timeout_sec > 0)
+        script += "timeout -k 5 " + std::to_string(timeout_sec) + " ";
+    script += "bash -c " + asyd::util::shell_quote(command) + " 2>&1";
+
+    // quoted once for the local shell, the server's shell gets the script;
+    // ssh's own errors (e.g., an unreachable server) go to [on_line] too
+    Command ssh_command;
+
+    this->ssh(ssh_command)
+        .add(asyd::util::shell_quote(script))
+        .add("2>&1", false);
+
+    bool success = ssh_command.stream(on_line, cancelled);
+    exit_status = ssh_command.get_exit_status();
+    return success;
+}
+
+bool Server::wait_until_ready(const std::string& probe_command, int timeout_sec) const
+{
+    std::string script = "timeout " + std::to_string(timeout_sec) + " ";
+    script += "bash -c " + asyd::util::shell_quote("until " + probe_command + "; do sleep 0.1; done");
+
+    // quoted once for the local shell, the server's shell gets the script
+    Command command;
+
+    this->ssh(command)
+        .add(asyd::util::shell_quote(script));
+
     if (!command.execute())
         return false;
 
     return true;
 }
 
+const std::string& Server::get_hostname() const
+{
+    return this->hostname;
+}
+
 const std::string& Server::get_home() const
 {
     return this->home_directory;
@@ -251,16 +883,16 @@ bool Server::check_status(const std::string& service_name, std::string& output)
 {
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("systemctl");
 
     if (!this->is_root)
         command.add("--user");
 
+    // quoted so a pattern (e.g., project@*.service) is matched by systemctl
     command.add("status")
-        .add("asyd-" + service_name, false)
+        .add("'asyd-" + service_name + "'", false)
         .addQuote();
 
     if (!command.execute())
@@ -274,8 +906,7 @@ bool Server::list_services(std::string& output) const
 {
     Command command;
 
-    command.add("ssh")
-        .add(this->hostname)
+    this->ssh(command)
         .addQuote()
         .add("systemctl --user --type=service --all", false)
         .addQuote();
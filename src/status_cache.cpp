@@ -0,0 +1,214 @@
+#include "status_cache.hpp"
+#include "util.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace asyd;
+
+StatusCache::StatusCache(const std::string& key)
+{
+    // the key ends up as a file name
+    this->key = key;
+    for (char& c : this->key)
+        if (c == '/')
+            c = '_';
+}
+
+std::string StatusCache::cache_path() const
+{
+    return asyd::util::get_asyd_dir() + ".status/" + this->key;
+}
+
+bool StatusCache::load(std::string& output, std::time_t& observed_at) const
+{
+    std::ifstream cache(this->cache_path());
+    if (!cache.is_open())
+        return false;
+
+    // observed_at=<unix time> followed by the output
+    std::string line;
+    if (!std::getline(cache, line))
+        return false;
+
+    auto [key, value] = asyd::util::parse_line(line);
+    if (key != "observed_at")
+        return false;
+    observed_at = std::atoll(value.c_str());
+
+    std::stringstream content;
+    content << cache.rdbuf();
+    output = content.str();
+    return true;
+}
+
+bool StatusCache::store(const std::string& output) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(asyd::util::get_asyd_dir() + ".status", error);
+
+    // written aside and moved in place so readers never see half of it
+    std::string temp_path = this->cache_path() + "." + std::to_string(getpid());
+    std::ofstream cache(temp_path);
+    if (!cache.is_open())
+        return false;
+
+    cache << "observed_at=" << std::time(nullptr) << "\n" << output;
+    cache.close();
+
+    std::filesystem::rename(temp_path, this->cache_path(), error);
+    return !error;
+}
+
+// now in nanoseconds since the epoch, comparable across processes
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// when the key was last invalidated (see now_ns()), 0 if never; [fd] is
+// the locked .invalidated file
+static int64_t read_invalidated_at(int fd)
+{
+    char buffer[32] = {};
+    ssize_t bytes_read = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    return bytes_read > 0 ? std::atoll(buffer) : 0;
+}
+
+void StatusCache::set_refresher(const std::vector<std::string>& argv)
+{
+    this->refresher = argv;
+}
+
+void StatusCache::revalidate_in_background() const
+{
+    if (this->refresher.empty())
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(asyd::util::get_asyd_dir() + ".status", error);
+
+    // only checks whether a refresh is running, the refresher takes the
+    // lock itself (see refresh())
+    int lock_fd = open((this->cache_path() + ".lock").c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (lock_fd < 0)
+        return;
+
+    bool refreshing = flock(lock_fd, LOCK_EX | LOCK_NB) != 0;
+    close(lock_fd);
+    if (refreshing)
+        return;
+
+    // a new process instead of a fork, which isn't safe in a process
+    // with other threads; detached from the terminal and from our
+    // stdout, so e.g. a shell prompt reading our output doesn't wait
+    std::vector<char*> argv;
+    for (const std::string& arg : this->refresher)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSID);
+
+    pid_t pid;
+    bool spawned = posix_spawn(&pid, argv[0], &actions, &attributes, argv.data(), environ) == 0;
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+
+    // the refresher forks and exits right away (see set_refresher())
+    if (spawned)
+        waitpid(pid, nullptr, 0);
+}
+
+bool StatusCache::refresh(const read_fn& live_read) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(asyd::util::get_asyd_dir() + ".status", error);
+
+    // held until the refresh is done so there's only one per key
+    int lock_fd = open((this->cache_path() + ".lock").c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (lock_fd < 0)
+        return false;
+
+    if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        close(lock_fd);
+        return false;
+    }
+
+    int64_t started = now_ns();
+    bool stored = false;
+
+    std::string output;
+    if (live_read(output))
+    {
+        // checked and stored under the same lock invalidate() takes, so an
+        // invalidation can't slip in between; what was read may be from
+        // before an action that invalidated it
+        int invalidated_fd = open((this->cache_path() + ".invalidated").c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+        if (invalidated_fd >= 0)
+        {
+            flock(invalidated_fd, LOCK_EX);
+            if (read_invalidated_at(invalidated_fd) < started)
+                stored = this->store(output);
+            close(invalidated_fd);
+        }
+    }
+
+    close(lock_fd);
+    return stored;
+}
+
+void StatusCache::invalidate() const
+{
+    std::error_code error;
+    std::filesystem::create_directories(asyd::util::get_asyd_dir() + ".status", error);
+
+    // tells a running refresh (see refresh()) when; written while holding
+    // the lock, so a refresh never sees it half written
+    std::string invalidated_path = this->cache_path() + ".invalidated";
+    int invalidated_fd = open(invalidated_path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (invalidated_fd >= 0)
+        flock(invalidated_fd, LOCK_EX);
+
+    std::filesystem::remove(this->cache_path(), error);
+    std::ofstream(invalidated_path) << now_ns();
+
+    if (invalidated_fd >= 0)
+        close(invalidated_fd);
+}
+
+bool StatusCache::read(const read_fn& live_read, bool fresh, std::string& output, long& age_sec)
+{
+    std::time_t observed_at = 0;
+    if (!fresh && this->load(output, observed_at))
+    {
+        age_sec = std::max<long>(std::time(nullptr) - observed_at, 0);
+        if (age_sec >= StatusCache::REVALIDATE_AFTER_SEC)
+            this->revalidate_in_background();
+        return true;
+    }
+
+    age_sec = 0;
+    if (!live_read(output))
+        return false;
+
+    this->store(output);
+    return true;
+}
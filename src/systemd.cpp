@@ -3,19 +3,128 @@
 
 using namespace asyd;
 
+const std::vector<std::pair<std::string, std::string>> Systemd::RESOURCE_CONTROLS = {
+    { "cpu_affinity", "CPUAffinity" },
+    { "cpu_quota", "CPUQuota" },
+    { "cpu_weight", "CPUWeight" },
+    { "memory_high", "MemoryHigh" },
+    { "memory_max", "MemoryMax" },
+    { "io_weight", "IOWeight" },
+    { "nice", "Nice" },
+    { "limit_nofile", "LimitNOFILE" },
+    { "tasks_max", "TasksMax" },
+};
+
+std::string Systemd::resource_control_directive(const std::string& config_key)
+{
+    for (const auto& [key, directive] : Systemd::RESOURCE_CONTROLS)
+        if (key == config_key)
+            return directive;
+
+    return "";
+}
+
 void Systemd::from_config(const Config& config)
 {
+    this->project_name = config.get_project_name();
     this->description = config.get_project_description();
     this->working_directory = config.get_server_home_directory() 
         + "/.asyd/" 
         + config.get_project_name();
+    this->is_templated = config.is_templated();
+    this->base_port = this->is_templated ? config.get_base_port() : "";
+
+    std::string command = this->working_directory + "/" + config.get_entry_point();
+    if (this->is_templated)
+    {
+        // systemd expands %i to the instance and turns $$ into $ and %% into %;
+        // the shell computes the instance's port and CPU from the Environment=
+        if (this->base_port.length() > 0)
+            command = "export ASYD_PORT=$$((ASYD_BASE_PORT + ASYD_INSTANCE)); exec " + command;
+        else
+            command = "exec " + command;
+
+        if (config.get_pin_instances())
+            command.insert(command.rfind("exec ") + 5, "taskset -c $$((ASYD_INSTANCE %% $$(nproc))) ");
+    }
+
     this->entry_point = config.get_server_bash_directory() 
         + " -c '" 
-        + this->working_directory
-        + "/" 
-        + config.get_entry_point()
-        + "'\n";
+        + command
+        + "'";
     this->is_sudo = config.get_service_username() == "sudo";
+    this->schedule = config.get_schedule();
+    this->randomized_delay_sec = config.get_randomized_delay_sec();
+    this->accuracy_sec = config.get_accuracy_sec();
+    this->persistent = config.get_persistent();
+    this->listen_stream = config.get_listen_stream();
+    this->idle_timeout_sec = config.get_idle_timeout_sec();
+    this->readiness = config.get_readiness();
+    this->reload_signal = config.get_reload_signal();
+    this->readiness_timeout_sec = std::to_string(config.get_readiness_timeout());
+
+    this->resource_controls.clear();
+    for (const auto& [key, value] : config.get_resource_controls())
+        this->resource_controls[Systemd::resource_control_directive(key)] = value;
+}
+
+void Systemd::to_config(Config& config) const
+{
+    const std::string& project_name = config.get_project_name();
+    config.set_project_description(this->description);
+
+    // WorkingDirectory=<home>/.asyd/<project>
+    std::string project_suffix = "/.asyd/" + project_name;
+    if (this->working_directory.length() > project_suffix.length()
+        && this->working_directory.compare(this->working_directory.length() - project_suffix.length(), std::string::npos, project_suffix) == 0)
+        config.set_server_home_directory(this->working_directory.substr(0, this->working_directory.length() - project_suffix.length()));
+
+    // ExecStart=<bash> -c '[...; exec [taskset ...] ]<working directory>/<entry point>'
+    size_t bash_end = this->entry_point.find(" -c '");
+    if (bash_end != std::string::npos)
+        config.set_server_bash_directory(this->entry_point.substr(0, bash_end));
+
+    size_t entry_start = this->entry_point.find(this->working_directory + "/");
+    if (entry_start != std::string::npos)
+    {
+        entry_start += this->working_directory.length() + 1;
+        size_t entry_end = this->entry_point.rfind('\'');
+        if (entry_end == std::string::npos || entry_end < entry_start)
+            entry_end = this->entry_point.length();
+        config.set_entry_point(this->entry_point.substr(entry_start, entry_end - entry_start));
+    }
+
+    config.set_schedule(this->schedule);
+    config.set_randomized_delay_sec(this->randomized_delay_sec);
+    config.set_accuracy_sec(this->accuracy_sec);
+    config.set_persistent(this->persistent);
+    config.set_listen_stream(this->listen_stream);
+    config.set_idle_timeout_sec(this->idle_timeout_sec);
+    config.set_reload_signal(this->reload_signal);
+
+    // other readiness checks (e.g., tcp) are done by asyd and not in the unit
+    if (this->readiness == "notify" || config.get_readiness() == "notify")
+        config.set_readiness(this->readiness);
+    if (this->readiness_timeout_sec.length() > 0)
+        config.set_readiness_timeout_sec(this->readiness_timeout_sec);
+
+    // the number of instances isn't in the template, it stays as it is
+    // (a template has at least two)
+    if (this->is_templated)
+    {
+        if (config.get_instances() < 2)
+            config.set_instances("2");
+        config.set_base_port(this->base_port);
+        config.set_pin_instances(this->entry_point.find("taskset ") != std::string::npos ? "true" : "false");
+    }
+    else
+        config.set_instances("1");
+
+    for (const auto& [key, directive] : Systemd::RESOURCE_CONTROLS)
+    {
+        auto value = this->resource_controls.find(directive);
+        config.set(key, value != this->resource_controls.end() ? value->second : "");
+    }
 }
 
 bool Systemd::from_file(const std::string& filepath)
@@ -34,7 +143,12 @@ bool Systemd::from_file(const std::string& filepath)
             {
                 key_action_fptr key_action = this->key_action[key];
                 (this->*key_action)(value);
+                continue;
             }
+
+            for (const auto& resource_control : Systemd::RESOURCE_CONTROLS)
+                if (resource_control.second == key)
+                    this->resource_controls[key] = asyd::util::strip_newline(value);
         }
     }
 
@@ -50,20 +164,155 @@ bool Systemd::to_file(const std::string& filepath)
 
     sysfile << "[Unit]\n";
     sysfile << "Description=" << this->description << "\n";
+    if (this->is_socket_activated())
+    {
+        sysfile << "Requires=asyd-" << this->project_name << ".socket\n";
+        sysfile << "After=asyd-" << this->project_name << ".socket\n";
+    }
 
     sysfile << "\n[Service]\n";
-    sysfile << "Type=simple\n";
-    sysfile << "Restart=always\n";
-    sysfile << "RestartSec=1\n";
+    if (this->is_job())
+    {
+        // a oneshot service stays "activating" until the run finishes and
+        // the timer won't start a unit that is still active, so runs never
+        // overlap. The timer takes care of (re)starting it.
+        sysfile << "Type=oneshot\n";
+    }
+    else
+    {
+        // with Type=notify the service reports when it's ready (sd_notify)
+        // and starting/restarting it only finishes once it did
+        if (this->readiness == "notify")
+        {
+            sysfile << "Type=notify\n";
+            sysfile << "TimeoutStartSec=" << this->readiness_timeout_sec << "\n";
+        }
+        else
+            sysfile << "Type=simple\n";
+
+        // a socket-activated service with an idle timeout is expected to
+        // exit on its own after being idle for ASYD_IDLE_TIMEOUT_SEC; a clean
+        // exit is not restarted so the next connection starts it again
+        if (this->is_socket_activated() && this->idle_timeout_sec.length() > 0)
+            sysfile << "Restart=on-failure\n";
+        else
+            sysfile << "Restart=always\n";
+        sysfile << "RestartSec=1\n";
+    }
     sysfile << "WorkingDirectory=" << this->working_directory << "\n";
     sysfile << "ExecStart=" << this->entry_point << "\n";
+    if (!this->is_job() && this->reload_signal.length() > 0)
+        sysfile << "ExecReload=/bin/kill -s " << this->reload_signal << " $MAINPID\n";
+    if (this->is_socket_activated() && this->idle_timeout_sec.length() > 0)
+        sysfile << "Environment=ASYD_IDLE_TIMEOUT_SEC=" << this->idle_timeout_sec << "\n";
+    if (this->is_templated)
+        sysfile << "Environment=ASYD_INSTANCE=%i\n";
+    if (this->is_templated && this->base_port.length() > 0)
+        sysfile << "Environment=ASYD_BASE_PORT=" << this->base_port << "\n";
 
-    sysfile << "\n[Install]\n";
-    if (this->is_sudo)
-        sysfile << "WantedBy=multi-user.target\n";
-    else
-        sysfile << "WantedBy=default.target\n";
+    // for the IO numbers of asyd top (the other counters are on by default)
+    sysfile << "IOAccounting=yes\n";
+
+    // written in a fixed order so regenerating the file is deterministic
+    for (const auto& resource_control : Systemd::RESOURCE_CONTROLS)
+    {
+        auto value = this->resource_controls.find(resource_control.second);
+        if (value != this->resource_controls.end())
+            sysfile << value->first << "=" << value->second << "\n";
+    }
+
+    // jobs are only started through their timer and socket-activated
+    // servers through their socket
+    if (!this->is_job() && !this->is_socket_activated())
+    {
+        sysfile << "\n[Install]\n";
+        if (this->is_sudo)
+            sysfile << "WantedBy=multi-user.target\n";
+        else
+            sysfile << "WantedBy=default.target\n";
+    }
     
     sysfile.close();
     return true;
 }
+
+bool Systemd::to_timer_file(const std::string& filepath)
+{
+    std::ofstream timerfile(filepath);
+    if (!timerfile.is_open())
+        return false;
+
+    timerfile << "[Unit]\n";
+    timerfile << "Description=" << this->description << "\n";
+
+    timerfile << "\n[Timer]\n";
+    timerfile << "OnCalendar=" << this->schedule << "\n";
+
+    // FixedRandomDelay makes the random delay stable per host and unit, so
+    // jobs with the same schedule are spread out (and stay spread out across
+    // reboots) instead of firing in the same second
+    if (this->randomized_delay_sec.length() > 0)
+    {
+        timerfile << "RandomizedDelaySec=" << this->randomized_delay_sec << "\n";
+        timerfile << "FixedRandomDelay=true\n";
+    }
+
+    if (this->accuracy_sec.length() > 0)
+        timerfile << "AccuracySec=" << this->accuracy_sec << "\n";
+
+    if (this->persistent.length() > 0)
+        timerfile << "Persistent=" << this->persistent << "\n";
+
+    timerfile << "\n[Install]\n";
+    timerfile << "WantedBy=timers.target\n";
+
+    timerfile.close();
+    return true;
+}
+
+bool Systemd::to_socket_file(const std::string& filepath)
+{
+    std::ofstream socketfile(filepath);
+    if (!socketfile.is_open())
+        return false;
+
+    socketfile << "[Unit]\n";
+    socketfile << "Description=" << this->description << "\n";
+
+    // systemd owns the listening socket and passes it to the service, so it
+    // stays open while the service is (re)started and connections are queued
+    // instead of refused
+    socketfile << "\n[Socket]\n";
+    socketfile << "ListenStream=" << this->listen_stream << "\n";
+
+    socketfile << "\n[Install]\n";
+    socketfile << "WantedBy=sockets.target\n";
+
+    socketfile.close();
+    return true;
+}
+
+void Systemd::set_exec_reload(const std::string& exec_reload)
+{
+    std::string value = asyd::util::strip_newline(exec_reload);
+
+    size_t signal_start = value.find("-s ");
+    if (signal_start == std::string::npos)
+        return;
+
+    signal_start += 3;
+    size_t signal_end = value.find(' ', signal_start);
+    this->reload_signal = value.substr(signal_start, signal_end - signal_start);
+}
+
+void Systemd::set_environment(const std::string& environment)
+{
+    auto [name, value] = asyd::util::parse_line(asyd::util::strip_newline(environment));
+
+    if (name == "ASYD_IDLE_TIMEOUT_SEC")
+        this->idle_timeout_sec = value;
+    else if (name == "ASYD_INSTANCE")
+        this->is_templated = true;
+    else if (name == "ASYD_BASE_PORT")
+        this->base_port = value;
+}
@@ -1,5 +1,8 @@
 #include "util.hpp"
 
+#include <algorithm>
+#include <cstdlib>
+
 std::pair<std::string, std::string> asyd::util::parse_line(const std::string& current_line)
 {
     std::string key = "";
@@ -8,7 +11,8 @@ std::pair<std::string, std::string> asyd::util::parse_line(const std::string& cu
 
     for (const char c : current_line)
     {
-        if (c == '=')
+        // only the first '=' separates the key, values may contain more
+        if (c == '=' && parsing_key)
         {
             parsing_key = false;
             continue;
@@ -31,3 +35,122 @@ std::string asyd::util::strip_newline(const std::string& value)
 
     return new_value;
 }
+
+std::string asyd::util::shell_quote(const std::string& value)
+{
+    std::string quoted = "'";
+    for (const char c : value)
+    {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+
+    return quoted + "'";
+}
+
+int asyd::util::parse_positive_int(const std::string& value)
+{
+    if (value.empty() || value.length() > 9)
+        return 0;
+
+    for (const char c : value)
+        if (c < '0' || c > '9')
+            return 0;
+
+    return std::atoi(value.c_str());
+}
+
+double asyd::util::parse_positive_double(const std::string& value)
+{
+    if (value.empty() || value.find_first_not_of("0123456789.") != std::string::npos)
+        return 0;
+
+    char* end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    if (*end != '\0' || !(number > 0))
+        return 0;
+
+    return number;
+}
+
+int64_t asyd::util::parse_counter(const std::string& value)
+{
+    if (value.empty() || value[0] < '0' || value[0] > '9')
+        return -1;
+
+    unsigned long long counter = std::strtoull(value.c_str(), nullptr, 10);
+    if (counter >= static_cast<unsigned long long>(INT64_MAX))
+        return -1;
+
+    return static_cast<int64_t>(counter);
+}
+
+bool asyd::util::order_dependencies(const std::vector<std::vector<size_t>>& dependencies, std::vector<size_t>& order)
+{
+    order.clear();
+
+    // repeatedly takes out the nodes whose dependencies were all taken
+    // out, what remains is a cycle or depends on one
+    std::vector<bool> ordered(dependencies.size(), false);
+    for (bool progress = true; progress;)
+    {
+        progress = false;
+        for (size_t i = 0; i < dependencies.size(); ++i)
+        {
+            if (ordered[i] || !std::all_of(dependencies[i].begin(), dependencies[i].end(), [&](size_t dependency) { return ordered[dependency]; }))
+                continue;
+
+            ordered[i] = true;
+            order.push_back(i);
+            progress = true;
+        }
+    }
+
+    return order.size() == dependencies.size();
+}
+
+std::vector<std::string> asyd::util::split(const std::string& value, char separator)
+{
+    std::vector<std::string> tokens;
+    std::string current_token = "";
+
+    for (size_t i = 0; i <= value.length(); ++i)
+    {
+        if (i < value.length() && value[i] != separator)
+        {
+            current_token += value[i];
+            continue;
+        }
+
+        size_t begin = current_token.find_first_not_of(" \t");
+        size_t end = current_token.find_last_not_of(" \t");
+        if (begin != std::string::npos)
+            tokens.push_back(current_token.substr(begin, end - begin + 1));
+
+        current_token = "";
+    }
+
+    return tokens;
+}
+
+// there is currently no portable way (that I know of) to do this as of C++17
+std::string asyd::util::get_home_dir()
+{
+    #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__) || defined(__NT__)
+        return std::string(std::getenv("HOMEDRIVE")) + std::string(std::getenv("HOMEPATH"));
+    #else
+        return std::string(std::getenv("HOME"));
+    #endif
+}
+
+std::string asyd::util::get_asyd_dir()
+{
+    return asyd::util::get_home_dir() + "/.asyd/";
+}
+
+std::string asyd::util::get_asyd_project_dir(const std::string& project_name)
+{
+    return asyd::util::get_asyd_dir() + project_name + "/";
+}
@@ -0,0 +1,177 @@
+#include "watcher.hpp"
+
+#include <filesystem>
+#include <array>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+using namespace asyd;
+
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+    | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF;
+
+Watcher::Watcher(const std::string& root_directory)
+{
+    this->root_directory = root_directory;
+}
+
+Watcher::~Watcher()
+{
+    if (this->inotify_fd >= 0)
+        close(this->inotify_fd);
+}
+
+bool Watcher::start()
+{
+    this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotify_fd < 0)
+        return false;
+
+    return this->add_watch_recursive("");
+}
+
+bool Watcher::add_watch(const std::string& relative_directory)
+{
+    std::string path = this->root_directory + "/" + relative_directory;
+    int wd = inotify_add_watch(this->inotify_fd, path.c_str(), WATCH_MASK);
+    if (wd < 0)
+        return false;
+
+    this->watch_directories[wd] = relative_directory;
+    return true;
+}
+
+bool Watcher::add_watch_recursive(const std::string& relative_directory)
+{
+    if (!this->add_watch(relative_directory))
+        return false;
+
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(
+        this->root_directory + "/" + relative_directory, error);
+    if (error)
+        return false;
+
+    for (const auto& entry : it)
+    {
+        if (!entry.is_directory() || entry.is_symlink())
+            continue;
+
+        std::string relative = std::filesystem::relative(entry.path(), this->root_directory).string();
+        if (!this->add_watch(relative))
+            return false;
+    }
+
+    return true;
+}
+
+void Watcher::add_directory_contents(
+    const std::string& relative_directory,
+    std::set<std::string>& changed_paths) const
+{
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(
+        this->root_directory + "/" + relative_directory, error);
+    if (error)
+        return;
+
+    for (const auto& entry : it)
+        if (!entry.is_directory())
+            changed_paths.insert(std::filesystem::relative(entry.path(), this->root_directory).string());
+}
+
+bool Watcher::read_events(std::set<std::string>& changed_paths)
+{
+    alignas(struct inotify_event) std::array<char, 8192> buffer;
+
+    while (true)
+    {
+        ssize_t length = read(this->inotify_fd, buffer.data(), buffer.size());
+        if (length < 0)
+            return errno == EAGAIN;
+
+        for (ssize_t i = 0; i < length; )
+        {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer.data() + i);
+            i += sizeof(struct inotify_event) + event->len;
+
+            // events were dropped, including ones for new directories
+            // that aren't watched yet
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                this->overflowed = true;
+                this->add_watch_recursive("");
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED)
+            {
+                this->watch_directories.erase(event->wd);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            const std::string& directory = this->watch_directories[event->wd];
+            std::string relative = directory.empty()
+                ? std::string(event->name)
+                : directory + "/" + event->name;
+
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+            {
+                this->add_watch_recursive(relative);
+                this->add_directory_contents(relative, changed_paths);
+                continue;
+            }
+
+            // deleted/moved away directories are removed as a whole
+            if ((event->mask & IN_ISDIR) && !(event->mask & (IN_DELETE | IN_MOVED_FROM)))
+                continue;
+
+            changed_paths.insert(relative);
+        }
+    }
+}
+
+bool Watcher::wait_for_changes(
+    std::vector<std::string>& changed_paths,
+    std::chrono::steady_clock::time_point& first_change,
+    int debounce_ms)
+{
+    std::set<std::string> changes;
+    struct pollfd fd = { this->inotify_fd, POLLIN, 0 };
+    this->overflowed = false;
+
+    // block until the first event of a burst
+    while (changes.empty() && !this->overflowed)
+    {
+        if (poll(&fd, 1, -1) < 0)
+            return false;
+
+        first_change = std::chrono::steady_clock::now();
+        if (!this->read_events(changes))
+            return false;
+    }
+
+    // keep collecting until no new events arrive within the debounce window
+    while (true)
+    {
+        int ready = poll(&fd, 1, debounce_ms);
+        if (ready < 0)
+            return false;
+
+        if (ready == 0)
+            break;
+
+        if (!this->read_events(changes))
+            return false;
+    }
+
+    if (this->overflowed)
+        this->add_directory_contents("", changes);
+
+    changed_paths.assign(changes.begin(), changes.end());
+    return true;
+}
@@ -0,0 +1,99 @@
+#include "check.hpp"
+#include "bandwidth.hpp"
+
+#include <atomic>
+#include <thread>
+
+using namespace asyd;
+
+typedef BandwidthScheduler::Priority Priority;
+
+static BandwidthScheduler& scheduler_with(int64_t bandwidth_limit, int64_t host_bandwidth_limit, size_t max_transfers)
+{
+    BandwidthScheduler::Limits limits;
+    limits.bandwidth_limit = bandwidth_limit;
+    limits.host_bandwidth_limit = host_bandwidth_limit;
+    limits.max_transfers = max_transfers;
+
+    BandwidthScheduler& scheduler = BandwidthScheduler::get();
+    scheduler.set_limits(limits);
+    return scheduler;
+}
+
+static void test_unlimited()
+{
+    BandwidthScheduler& scheduler = scheduler_with(0, 0, 4);
+
+    BandwidthScheduler::Ticket ticket = scheduler.acquire("a", "unlimited", 100, Priority::NORMAL);
+    CHECK(ticket.get_bandwidth_limit() == 0);
+}
+
+static void test_shares_by_priority()
+{
+    // 4 slots of 250 KB/s, all but urgent transfers leave one free
+    BandwidthScheduler& scheduler = scheduler_with(1000, 0, 4);
+
+    {
+        BandwidthScheduler::Ticket normal = scheduler.acquire("a", "normal", 100, Priority::NORMAL);
+        CHECK(normal.get_bandwidth_limit() == 750);
+
+        // the reserved slot
+        BandwidthScheduler::Ticket urgent = scheduler.acquire("a", "urgent", 100, Priority::URGENT);
+        CHECK(urgent.get_bandwidth_limit() == 250);
+    }
+
+    {
+        BandwidthScheduler::Ticket urgent = scheduler.acquire("a", "urgent", 100, Priority::URGENT);
+        CHECK(urgent.get_bandwidth_limit() == 1000);
+    }
+
+    {
+        BandwidthScheduler::Ticket bulk = scheduler.acquire("a", "bulk", 100, Priority::BULK);
+        CHECK(bulk.get_bandwidth_limit() == 500);
+    }
+}
+
+static void test_host_limits_are_per_host()
+{
+    BandwidthScheduler& scheduler = scheduler_with(0, 400, 4);
+
+    BandwidthScheduler::Ticket first = scheduler.acquire("a", "to a", 100, Priority::NORMAL);
+    BandwidthScheduler::Ticket second = scheduler.acquire("b", "to b", 100, Priority::NORMAL);
+    CHECK(first.get_bandwidth_limit() == 300);
+    CHECK(second.get_bandwidth_limit() == 300);
+}
+
+static void test_waits_for_a_slot()
+{
+    BandwidthScheduler& scheduler = scheduler_with(0, 0, 1);
+
+    std::atomic<bool> started{false};
+    std::thread waiting;
+    {
+        BandwidthScheduler::Ticket first = scheduler.acquire("a", "first", 100, Priority::NORMAL);
+
+        waiting = std::thread([&]() {
+            BandwidthScheduler::Ticket second = scheduler.acquire("a", "second", 100, Priority::NORMAL);
+            started = true;
+        });
+
+        // queued behind the active transfer
+        while (scheduler.get_transfers().size() < 2)
+            std::this_thread::yield();
+        CHECK(!started);
+    }
+
+    waiting.join();
+    CHECK(started);
+    CHECK(scheduler.get_transfers().empty());
+}
+
+int main()
+{
+    test_unlimited();
+    test_shares_by_priority();
+    test_host_limits_are_per_host();
+    test_waits_for_a_slot();
+
+    return asyd::test::report("bandwidth_share");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the tests in this directory: every tests/*.cpp is a
+// program that runs its checks and returns non-zero if any failed
+// (see "make test").
+namespace asyd
+{
+namespace test
+{
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+// exit code of a test program
+inline int report(const char* test_name)
+{
+    if (failures() > 0)
+        std::cerr << test_name << ": " << failures() << " check(s) failed\n";
+    else
+        std::cout << test_name << ": OK\n";
+
+    return failures() > 0 ? 1 : 0;
+}
+}; // namespace test
+}; // namespace asyd
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            asyd::test::failures()++;                                                       \
+        }                                                                                   \
+    } while (0)
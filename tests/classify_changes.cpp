@@ -0,0 +1,55 @@
+#include "check.hpp"
+#include "config.hpp"
+
+using namespace asyd;
+
+static Config make_config(const std::string& reload_signal)
+{
+    Config config;
+    config.set("restart_paths", "lib/*");
+    config.set("reload_paths", "templates/*,lib/*.html");
+    config.set("ignore_paths", "static/*");
+    config.set("reload_signal", reload_signal);
+    return config;
+}
+
+static void test_single_paths()
+{
+    Config config = make_config("HUP");
+
+    CHECK(config.classify_changes({}) == ChangeAction::NONE);
+    CHECK(config.classify_changes({ "static/app.css" }) == ChangeAction::NONE);
+    CHECK(config.classify_changes({ "templates/index.html" }) == ChangeAction::RELOAD);
+    CHECK(config.classify_changes({ "lib/app.py" }) == ChangeAction::RESTART);
+
+    // paths no rule matches need a restart to be safe
+    CHECK(config.classify_changes({ "main.py" }) == ChangeAction::RESTART);
+}
+
+static void test_most_disruptive_wins()
+{
+    Config config = make_config("HUP");
+
+    CHECK(config.classify_changes({ "static/app.css", "templates/index.html" }) == ChangeAction::RELOAD);
+    CHECK(config.classify_changes({ "templates/index.html", "main.py", "static/app.css" }) == ChangeAction::RESTART);
+
+    // restart_paths go before reload_paths
+    CHECK(config.classify_changes({ "lib/page.html" }) == ChangeAction::RESTART);
+}
+
+static void test_reload_needs_signal()
+{
+    Config config = make_config("");
+
+    CHECK(config.classify_changes({ "templates/index.html" }) == ChangeAction::RESTART);
+    CHECK(config.classify_changes({ "static/app.css" }) == ChangeAction::NONE);
+}
+
+int main()
+{
+    test_single_paths();
+    test_most_disruptive_wins();
+    test_reload_needs_signal();
+
+    return asyd::test::report("classify_changes");
+}
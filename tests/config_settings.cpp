@@ -0,0 +1,70 @@
+#include "check.hpp"
+#include "config.hpp"
+
+using namespace asyd;
+
+static void test_instances()
+{
+    Config config;
+    CHECK(config.get_instances() == 1);
+
+    CHECK(config.set("instances", "4"));
+    CHECK(config.get_instances() == 4);
+
+    CHECK(!config.set("instances", "0"));
+    CHECK(!config.set("instances", "-2"));
+    CHECK(!config.set("instances", "4x"));
+    CHECK(!config.set("instances", "99999999999999999999"));
+    CHECK(config.get_instances() == 4);
+
+    // back to the default
+    CHECK(config.set("instances", ""));
+    CHECK(config.get_instances() == 1);
+}
+
+static void test_relay_fanout()
+{
+    Config config;
+    CHECK(config.set("relay_fanout", "0"));
+    CHECK(config.get_relay_fanout() == 0);
+    CHECK(config.set("relay_fanout", "3"));
+    CHECK(config.get_relay_fanout() == 3);
+
+    CHECK(!config.set("relay_fanout", "three"));
+    CHECK(!config.set("relay_fanout", " 2"));
+    CHECK(config.get_relay_fanout() == 3);
+}
+
+static void test_timeouts_and_fractions()
+{
+    Config config;
+    CHECK(!config.set("readiness_timeout_sec", "0"));
+    CHECK(config.set("readiness_timeout_sec", "5"));
+    CHECK(config.get_readiness_timeout() == 5);
+
+    CHECK(!config.set("overrun_fraction", "-0.5"));
+    CHECK(config.set("overrun_fraction", "0.5"));
+    CHECK(config.get_overrun_fraction() == 0.5);
+}
+
+static void test_unknown_keys()
+{
+    Config config;
+    CHECK(!config.is_setting("instance"));
+    CHECK(!config.set("instance", "2"));
+    CHECK(config.is_setting("instances"));
+    CHECK(config.is_setting("memory_max"));
+
+    CHECK(Config::expected_value("instances").length() > 0);
+    CHECK(Config::expected_value("project_name").empty());
+}
+
+int main()
+{
+    test_instances();
+    test_relay_fanout();
+    test_timeouts_and_fractions();
+    test_unknown_keys();
+
+    return asyd::test::report("config_settings");
+}
@@ -0,0 +1,57 @@
+#include "check.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+using namespace asyd;
+
+// true if every node in [order] comes after its dependencies
+static bool respects(const std::vector<std::vector<size_t>>& dependencies, const std::vector<size_t>& order)
+{
+    for (size_t position = 0; position < order.size(); ++position)
+        for (size_t dependency : dependencies[order[position]])
+            if (std::find(order.begin(), order.begin() + position, dependency) == order.begin() + position)
+                return false;
+
+    return true;
+}
+
+static void test_without_cycles()
+{
+    std::vector<size_t> order;
+    CHECK(asyd::util::order_dependencies({}, order));
+    CHECK(order.empty());
+
+    // 0 <- 1 <- 2, listed backwards
+    CHECK(asyd::util::order_dependencies({ { 1 }, { 2 }, {} }, order));
+    CHECK((order == std::vector<size_t>{ 2, 1, 0 }));
+
+    // 3 needs 1 and 2, which both need 0
+    std::vector<std::vector<size_t>> diamond = { {}, { 0 }, { 0 }, { 1, 2 } };
+    CHECK(asyd::util::order_dependencies(diamond, order));
+    CHECK(order.size() == 4);
+    CHECK(respects(diamond, order));
+}
+
+static void test_cycles()
+{
+    std::vector<size_t> order;
+
+    CHECK(!asyd::util::order_dependencies({ { 1 }, { 0 } }, order));
+    CHECK(order.empty());
+
+    CHECK(!asyd::util::order_dependencies({ { 0 } }, order));
+
+    // 0 is independent, 1 -> 2 -> 3 -> 1 is a cycle and 4 depends on it
+    std::vector<std::vector<size_t>> graph = { {}, { 2 }, { 3 }, { 1 }, { 0, 3 } };
+    CHECK(!asyd::util::order_dependencies(graph, order));
+    CHECK((order == std::vector<size_t>{ 0 }));
+}
+
+int main()
+{
+    test_without_cycles();
+    test_cycles();
+
+    return asyd::test::report("dependency_order");
+}
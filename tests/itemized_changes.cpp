@@ -0,0 +1,57 @@
+#include "check.hpp"
+#include "server.hpp"
+
+using namespace asyd;
+
+static void test_changed_files()
+{
+    std::vector<std::string> changed_paths;
+    Server::parse_itemized_changes(
+        ">f+++++++++ run.sh\n"
+        ">f.st...... static/app.css\n"
+        "cL+++++++++ current\n"
+        "hf+++++++++ static/copy.css\n"
+        "<f.st...... uploaded.log\n",
+        changed_paths);
+
+    CHECK(changed_paths.size() == 5);
+    CHECK(changed_paths[0] == "run.sh");
+    CHECK(changed_paths[1] == "static/app.css");
+    CHECK(changed_paths[2] == "current");
+    CHECK(changed_paths[3] == "static/copy.css");
+    CHECK(changed_paths[4] == "uploaded.log");
+}
+
+static void test_skipped_lines()
+{
+    std::vector<std::string> changed_paths;
+    Server::parse_itemized_changes(
+        "cd+++++++++ static/\n"
+        ".d..t...... ./\n"
+        ".f...p..... run.sh\n"
+        "*deleting   old.txt\n"
+        "\n"
+        "sent 120 bytes  received 35 bytes\n"
+        ">f+++",
+        changed_paths);
+
+    CHECK(changed_paths.empty());
+}
+
+static void test_appends()
+{
+    std::vector<std::string> changed_paths = { "first.txt" };
+    Server::parse_itemized_changes(">f+++++++++ second.txt", changed_paths);
+
+    CHECK(changed_paths.size() == 2);
+    CHECK(changed_paths[1] == "second.txt");
+}
+
+int main()
+{
+    test_changed_files();
+    test_skipped_lines();
+    test_appends();
+
+    return asyd::test::report("itemized_changes");
+}
@@ -0,0 +1,132 @@
+#include "check.hpp"
+#include "logs.hpp"
+
+#include <thread>
+
+using namespace asyd;
+
+// a source that passes on [lines] and ends
+static LogMerger::reader_fn lines_of(const std::vector<std::string>& lines)
+{
+    return [lines](int, bool, const std::function<bool(const std::string&)>& on_line, const std::atomic<bool>*) {
+        for (const std::string& line : lines)
+            if (!on_line(line))
+                return;
+    };
+}
+
+static std::vector<LogMerger::Entry> merge(LogMerger& merger)
+{
+    std::vector<LogMerger::Entry> entries;
+    merger.run(10, false, [&](const LogMerger::Entry& entry) { entries.push_back(entry); }, []() { return true; });
+    return entries;
+}
+
+static void test_time_order()
+{
+    LogMerger merger;
+    merger.add_source(lines_of({
+        "1700000000.000001 api[1]: a1",
+        "1700000002.000000 api[1]: a2",
+        "1700000002.500000 api[1]: a3",
+    }), "a");
+    merger.add_source(lines_of({
+        "1700000001.000000 db[2]: b1",
+        "-- Boot 0123456789abcdef --",
+        "1700000002.250000 db[2]: b2",
+    }), "b");
+
+    std::vector<LogMerger::Entry> entries = merge(merger);
+    CHECK(entries.size() == 5);
+    if (entries.size() != 5)
+        return;
+
+    CHECK(entries[0].message == "api[1]: a1" && entries[0].source == "a");
+    CHECK(entries[1].message == "db[2]: b1" && entries[1].source == "b");
+    CHECK(entries[2].message == "api[1]: a2");
+    CHECK(entries[3].message == "db[2]: b2");
+    CHECK(entries[4].message == "api[1]: a3");
+    CHECK(entries[1].timestamp_us == 1700000001000000);
+}
+
+static void test_continuation_lines()
+{
+    // journalctl indents them to the message
+    std::string indent(std::string("1700000000.000001 api[1]: ").length(), ' ');
+
+    LogMerger merger;
+    merger.add_source(lines_of({
+        "1700000000.000001 api[1]: Traceback:",
+        indent + "  File \"app.py\"",
+        indent + "KeyError",
+        "1700000001.000000 api[1]: next",
+    }), "a");
+
+    // holds up the merge until all of them were read
+    merger.add_source([](int, bool, const std::function<bool(const std::string&)>& on_line, const std::atomic<bool>*) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        on_line("1700000002.000000 db[2]: later");
+    }, "b");
+
+    std::vector<LogMerger::Entry> entries = merge(merger);
+    CHECK(entries.size() == 3);
+    if (entries.size() != 3)
+        return;
+
+    CHECK(entries[0].message == "api[1]: Traceback:\n  File \"app.py\"\nKeyError");
+    CHECK(entries[1].message == "api[1]: next");
+    CHECK(entries[2].source == "b");
+}
+
+static void test_bounded_buffers()
+{
+    std::vector<std::string> a_lines;
+    std::vector<std::string> b_lines;
+    for (int i = 0; i < 50; ++i)
+    {
+        a_lines.push_back("17000000" + std::to_string(10 + i) + ".000000 a");
+        b_lines.push_back("17000000" + std::to_string(10 + i) + ".500000 b");
+    }
+
+    LogMerger merger(std::chrono::milliseconds(500), 1);
+    merger.add_source(lines_of(a_lines), "a");
+    merger.add_source(lines_of(b_lines), "b");
+
+    std::vector<LogMerger::Entry> entries = merge(merger);
+    CHECK(entries.size() == 100);
+
+    bool ordered = true;
+    for (size_t i = 1; i < entries.size(); ++i)
+        ordered = ordered && entries[i - 1].timestamp_us <= entries[i].timestamp_us;
+    CHECK(ordered);
+}
+
+static void test_silent_sources_dont_hold_up()
+{
+    LogMerger merger(std::chrono::milliseconds(50));
+    merger.add_source(lines_of({ "1700000000.000000 a", "1700000001.000000 a" }), "a");
+
+    // runs until the merge is stopped without writing anything
+    merger.add_source([](int, bool, const std::function<bool(const std::string&)>&, const std::atomic<bool>* cancelled) {
+        while (!cancelled->load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }, "silent");
+
+    size_t received = 0;
+    auto started = std::chrono::steady_clock::now();
+    merger.run(10, true, [&](const LogMerger::Entry&) { received++; }, [&]() {
+        return received < 2 && std::chrono::steady_clock::now() - started < std::chrono::seconds(5);
+    });
+
+    CHECK(received == 2);
+}
+
+int main()
+{
+    test_time_order();
+    test_continuation_lines();
+    test_bounded_buffers();
+    test_silent_sources_dont_hold_up();
+
+    return asyd::test::report("log_merge");
+}
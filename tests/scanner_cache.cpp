@@ -0,0 +1,86 @@
+#include "check.hpp"
+#include "scanner.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace asyd;
+
+static void write_file(const std::string& path, const std::string& content)
+{
+    std::ofstream file(path);
+    file << content;
+}
+
+static void test_unchanged_files_arent_hashed_again(const std::string& root, const std::string& cache)
+{
+    std::filesystem::create_directories(root + "/static");
+    write_file(root + "/run.sh", "#!/bin/bash\n");
+    write_file(root + "/static/app.css", "body {}\n");
+    std::filesystem::create_symlink("run.sh", root + "/link.sh");
+
+    Scanner first(root, cache);
+    CHECK(first.scan());
+    CHECK(first.get_stats().files == 2);
+    CHECK(first.get_stats().files_hashed == 2);
+    CHECK(first.get_entries().count("link.sh") == 0);
+
+    // a new scanner starts from the cache file
+    Scanner second(root, cache);
+    CHECK(second.scan());
+    CHECK(second.get_stats().files == 2);
+    CHECK(second.get_stats().files_hashed == 0);
+    CHECK(second.get_tree_hash() == first.get_tree_hash());
+
+    write_file(root + "/static/app.css", "body { margin: 0; }\n");
+
+    Scanner third(root, cache);
+    CHECK(third.scan());
+    CHECK(third.get_stats().files_hashed == 1);
+    CHECK(third.get_tree_hash() != first.get_tree_hash());
+}
+
+static void test_stat_only_scan_keeps_hashes(const std::string& root, const std::string& cache)
+{
+    Scanner stat_only(root, cache);
+    CHECK(stat_only.scan(false));
+    CHECK(stat_only.get_stats().files_hashed == 0);
+    CHECK(stat_only.get_entries().at("run.sh").hashed);
+}
+
+static void test_unreadable_trees_fail(const std::string& root, const std::string& cache)
+{
+    Scanner missing(root + "/missing", cache + ".missing");
+    CHECK(!missing.scan());
+
+    // root reads any directory
+    if (geteuid() == 0)
+        return;
+
+    std::filesystem::create_directories(root + "/private");
+    std::filesystem::permissions(root + "/private", std::filesystem::perms::none);
+
+    Scanner unreadable(root, cache);
+    CHECK(!unreadable.scan());
+
+    std::filesystem::permissions(root + "/private", std::filesystem::perms::owner_all);
+}
+
+int main()
+{
+    char directory[] = "/tmp/asyd-test-XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+
+    std::string root = std::string(directory) + "/tree";
+    std::string cache = std::string(directory) + "/scan.cache";
+
+    test_unchanged_files_arent_hashed_again(root, cache);
+    test_stat_only_scan_keeps_hashes(root, cache);
+    test_unreadable_trees_fail(root, cache);
+
+    std::filesystem::remove_all(directory);
+    return asyd::test::report("scanner_cache");
+}
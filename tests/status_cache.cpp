@@ -0,0 +1,91 @@
+#include "check.hpp"
+#include "status_cache.hpp"
+
+#include <filesystem>
+#include <thread>
+#include <cstdlib>
+
+using namespace asyd;
+
+static StatusCache::read_fn reads(const std::string& output, int delay_ms = 0)
+{
+    return [output, delay_ms](std::string& live_output) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        live_output = output;
+        return true;
+    };
+}
+
+static void test_live_read_and_cache()
+{
+    StatusCache cache("status-web");
+
+    std::string output;
+    long age_sec = -1;
+    CHECK(cache.read(reads("active"), false, output, age_sec));
+    CHECK(output == "active" && age_sec == 0);
+
+    // answered from the cache
+    CHECK(cache.read(reads("inactive"), false, output, age_sec));
+    CHECK(output == "active");
+
+    CHECK(cache.read(reads("inactive"), true, output, age_sec));
+    CHECK(output == "inactive");
+}
+
+static void test_refresh()
+{
+    StatusCache cache("ls-h1");
+
+    std::string output;
+    long age_sec = 0;
+    CHECK(cache.refresh(reads("api, web")));
+    CHECK(cache.read(reads("unused"), false, output, age_sec));
+    CHECK(output == "api, web");
+
+    // what's read before an invalidation isn't stored
+    std::thread invalidating([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        cache.invalidate();
+    });
+    CHECK(!cache.refresh(reads("stale", 200)));
+    invalidating.join();
+    CHECK(cache.read(reads("live"), false, output, age_sec));
+    CHECK(output == "live");
+
+    // but what's read after one is
+    cache.invalidate();
+    CHECK(cache.refresh(reads("after")));
+    CHECK(cache.read(reads("unused"), false, output, age_sec));
+    CHECK(output == "after");
+}
+
+static void test_one_refresh_at_a_time()
+{
+    StatusCache cache("status-api");
+
+    bool second = true;
+    std::thread first([&]() { cache.refresh(reads("first", 200)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    second = cache.refresh(reads("second"));
+    first.join();
+
+    CHECK(!second);
+}
+
+int main()
+{
+    char directory[] = "/tmp/asyd-test-XXXXXX";
+    if (mkdtemp(directory) == nullptr)
+        return 1;
+
+    // the cache lives in ~/.asyd/.status
+    setenv("HOME", directory, 1);
+
+    test_live_read_and_cache();
+    test_refresh();
+    test_one_refresh_at_a_time();
+
+    std::filesystem::remove_all(directory);
+    return asyd::test::report("status_cache");
+}